@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+#include "frame_arena.h"
+
+// Window dimensions
+const int WINDOW_WIDTH = 800;
+const int WINDOW_HEIGHT = 600;
+
+// Legacy text status: oxygen and food only
+const char* const STATUS_FILE = "aquarium_status.txt";
+
+// Fish species and their swim animation. A sprite holds sheetColumns frames
+// side by side; a one-frame sprite can instead be bent into swimFrames frames
+// when the sprite atlas is built.
+struct FishSpecies {
+    const char* sprite;
+    int sheetColumns;
+    int swimFrames;         // 0 to use the sheet's frames as drawn
+    float framesPerSecond;  // at FISH_CRUISE_SPEED
+};
+
+const int FISH_SPECIES_COUNT = 1;
+const int FISH_MAX_SPECIES = 16;        // size of the shader's animation table
+const FishSpecies FISH_SPECIES[FISH_SPECIES_COUNT] = {
+    { "fish.png", 1, 8, 10.0f },
+};
+const float FISH_CRUISE_SPEED = 0.3f;
+const int FISH_SWIM_PHASES = 64;        // Fish::swimPhase steps per cycle
+
+class FishStats;
+
+// Fish and Button Structures
+struct Fish {
+    float x, y;
+    float dx, dy;
+    float size;
+    bool facingRight;
+    float happiness; // 0..1
+    bool isDying = false;
+    uint8_t species = 0; // index into FISH_SPECIES
+    uint8_t swimPhase = 0; // offset into the swim cycle, in 1/FISH_SWIM_PHASES
+};
+
+struct Button {
+    float x, y, width, height;
+    const char* label;
+};
+
+// Global Variables
+extern std::vector<Fish> fishes;
+extern std::vector<Fish> fishesLeftOut; // set aside by applyFishBudget, saved with the tank
+extern float oxygenLevel;
+extern float foodLevel;
+extern float lastTime;
+extern bool areFishesDying;
+extern uint64_t simulationTick;
+
+extern Button feedButton;
+extern Button oxygenButton;
+
+// Function Prototypes
+GLuint createTextShaderProgram();
+GLuint createShaderProgram(const char* vtxSrc, const char* fragSrc);
+void ortho(float left, float right, float bottom, float top, float near, float far, float* mat);
+void stepSimulation(float dt, FishStats& stats);
+void applyClick(float nx, float ny);
+void updateFish(Fish& f, float dt);
+void initFishes(int count);
+// Moves the fish past what the fish budget holds (--fish-budget) out of the
+// tank into fishesLeftOut and updates its memory count; call whenever the
+// tank is replaced. Returns how many were left out.
+size_t applyFishBudget();
+bool checkButtonClick(const Button& btn, float mx, float my);
+// Fills 'verts' with x,y pairs (4 per quad) for stb_easy_font text scaled by 'scale'; returns the quad count.
+int layoutText(float x, float y, const char* text, float scale, std::vector<float>& verts);
+int layoutText(float x, float y, const char* text, float scale, FrameVector<float>& verts);
+void saveStatus(float oxygen, float food, const char* path = STATUS_FILE);
+bool loadStatus(float& oxygen, float& food, const char* path = STATUS_FILE);
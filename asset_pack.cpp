@@ -0,0 +1,187 @@
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "aquarium.h"
+#include "atomic_file.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "sprite_atlas.h"
+#include "water_overlay.h"
+
+static_assert(sizeof(AssetPackHeader) == 32, "AssetPackHeader must stay 32 bytes");
+static_assert(sizeof(AssetPackEntry) == 64, "AssetPackEntry is packed as is");
+
+AssetPack assetPack;
+
+// Directory of the running executable with a trailing separator, or empty
+// if it cannot be told.
+static std::string executableDirectory() {
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    if (length == 0 || length == MAX_PATH) return std::string();
+#else
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+    if (length <= 0 || length == (ssize_t)sizeof(path)) return std::string();
+#endif
+    std::string directory(path, (size_t)length);
+    size_t separator = directory.find_last_of("/\\");
+    return separator == std::string::npos ? std::string() : directory.substr(0, separator + 1);
+}
+
+static size_t alignUp(size_t offset) {
+    return (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+}
+
+bool AssetPack::open(const char* path) {
+    PROFILE_SCOPE("Asset pack open");
+    close();
+    if (!file_.open(path)) return false;
+    path_ = path;
+
+    AssetPackHeader header;
+    bool valid = file_.size() >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, file_.data(), sizeof(header));
+        valid = header.magic == ASSET_PACK_MAGIC && header.version == ASSET_PACK_VERSION &&
+            header.headerSize == sizeof(header) && header.entrySize == sizeof(AssetPackEntry) &&
+            header.entryCount <= (file_.size() - sizeof(header)) / sizeof(AssetPackEntry);
+    }
+    const uint8_t* index = file_.data() + sizeof(AssetPackHeader);
+    size_t indexSize = valid ? (size_t)header.entryCount * sizeof(AssetPackEntry) : 0;
+    valid = valid && snapshotChecksum(index, indexSize) == header.indexChecksum;
+    // Entries are used straight from the mapping, which is page-aligned, so
+    // they are as aligned as the header leaves them.
+    const AssetPackEntry* entries = reinterpret_cast<const AssetPackEntry*>(index);
+    for (uint32_t i = 0; valid && i < header.entryCount; i++) {
+        const AssetPackEntry& entry = entries[i];
+        valid = std::memchr(entry.name, 0, ASSET_NAME_LENGTH) != nullptr &&
+            entry.offset % ASSET_PACK_ALIGNMENT == 0 && entry.offset <= file_.size() &&
+            entry.size <= file_.size() - entry.offset &&
+            (i == 0 || std::strcmp(entries[i - 1].name, entry.name) < 0);
+    }
+    if (!valid) {
+        std::cerr << "Asset pack " << path << " is damaged, loading loose assets\n";
+        close();
+        return false;
+    }
+    entries_ = entries;
+    entryCount_ = header.entryCount;
+    return true;
+}
+
+bool AssetPack::openDefault() {
+    std::string besideExecutable = executableDirectory() + ASSET_PACK_FILE;
+    return open(besideExecutable.c_str()) || open(ASSET_PACK_FILE);
+}
+
+void AssetPack::close() {
+    file_.close();
+    entries_ = nullptr;
+    entryCount_ = 0;
+    path_.clear();
+}
+
+AssetView AssetPack::find(const char* name) const {
+    AssetView view;
+    const AssetPackEntry* end = entries_ + entryCount_;
+    const AssetPackEntry* entry = std::lower_bound(entries_, end, name,
+        [](const AssetPackEntry& e, const char* key) { return std::strcmp(e.name, key) < 0; });
+    if (entry == end || std::strcmp(entry->name, name) != 0) return view;
+
+    const uint8_t* data = file_.data() + entry->offset;
+    if (snapshotChecksum(data, (size_t)entry->size) != entry->checksum) {
+        std::cerr << "Asset " << name << " in " << path_ << " is corrupt\n";
+        return view;
+    }
+    view.data = data;
+    view.size = (size_t)entry->size;
+    return view;
+}
+
+void AssetPackWriter::add(const char* name, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    assets_.push_back({ name, std::vector<uint8_t>(bytes, bytes + size) });
+}
+
+bool AssetPackWriter::write(const char* path) {
+    std::sort(assets_.begin(), assets_.end(), [](const Asset& a, const Asset& b) { return a.name < b.name; });
+    std::vector<AssetPackEntry> entries(assets_.size());
+    size_t offset = alignUp(sizeof(AssetPackHeader) + entries.size() * sizeof(AssetPackEntry));
+    for (size_t i = 0; i < assets_.size(); i++) {
+        const Asset& asset = assets_[i];
+        if (asset.name.size() >= ASSET_NAME_LENGTH || (i > 0 && asset.name == assets_[i - 1].name)) {
+            std::cerr << "Asset name " << asset.name << " is too long or used twice\n";
+            return false;
+        }
+        AssetPackEntry& entry = entries[i];
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.name, asset.name.c_str(), asset.name.size());
+        entry.offset = offset;
+        entry.size = asset.data.size();
+        entry.checksum = snapshotChecksum(asset.data.data(), asset.data.size());
+        offset = alignUp(offset + asset.data.size());
+    }
+
+    AssetPackHeader header = {};
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.headerSize = sizeof(header);
+    header.entryCount = (uint32_t)entries.size();
+    header.entrySize = sizeof(AssetPackEntry);
+    header.indexChecksum = snapshotChecksum(entries.data(), entries.size() * sizeof(AssetPackEntry));
+
+    AtomicFileWriter writer;
+    std::vector<uint8_t> padding(ASSET_PACK_ALIGNMENT, 0);
+    size_t written = sizeof(header) + entries.size() * sizeof(AssetPackEntry);
+    bool ok = writer.open(path) && writer.write(&header, sizeof(header)) &&
+        writer.write(entries.data(), entries.size() * sizeof(AssetPackEntry));
+    for (size_t i = 0; ok && i < assets_.size(); i++) {
+        ok = writer.write(padding.data(), entries[i].offset - written) &&
+            writer.write(assets_[i].data.data(), assets_[i].data.size());
+        written = entries[i].offset + assets_[i].data.size();
+    }
+    if (!ok || !writer.commit()) {
+        std::cerr << "Failed to write asset pack " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+int runAssetPackBuild(const char* path) {
+    // Built from the source images, so no pack may be open yet; the atlas
+    // cache is still used while it matches them.
+    SpriteSheet sheets[FISH_SPECIES_COUNT];
+    for (int i = 0; i < FISH_SPECIES_COUNT; i++) {
+        sheets[i] = { FISH_SPECIES[i].sprite, FISH_SPECIES[i].sheetColumns, FISH_SPECIES[i].swimFrames };
+    }
+    SpriteAtlas atlas;
+    if (!atlas.loadTexels(sheets, FISH_SPECIES_COUNT, ATLAS_CACHE_FILE)) return -1;
+    std::vector<uint8_t> atlasBytes;
+    atlas.encode(atlasBytes);
+
+    WaterOverlayImage overlay;
+    if (!overlay.load(WATER_OVERLAY_FILE, WATER_OVERLAY_CACHE_FILE, true)) return -1;
+    std::vector<uint8_t> overlayBytes;
+    overlay.encode(overlayBytes);
+
+    AssetPackWriter writer;
+    writer.add(ASSET_SPRITE_ATLAS, atlasBytes.data(), atlasBytes.size());
+    writer.add(ASSET_WATER_OVERLAY, overlayBytes.data(), overlayBytes.size());
+    if (!writer.write(path)) return -1;
+    std::cout << "Packed the sprite atlas (" << atlas.layers() << " layers) and the "
+        << overlay.width() << "x" << overlay.height() << " water overlay into " << path << "\n";
+    return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+const char* const ASSET_PACK_FILE = "aquarium.pak";
+const char* const ASSET_SPRITE_ATLAS = "sprite_atlas";  // the atlas cache file layout, built from every species
+const char* const ASSET_WATER_OVERLAY = "water_overlay"; // the overlay cache file layout
+
+// Pack layout (host byte order: headers and payloads are memcpy'd as they
+// are in memory, like the snapshot and the caches the payloads come from):
+//   AssetPackHeader      32 bytes
+//   AssetPackEntry       one per asset, sorted by name
+//   payloads             each starting at a multiple of ASSET_PACK_ALIGNMENT
+// A pack only loads where it was built for: on a host of the other byte
+// order the magic does not match and the loose assets are loaded instead.
+const uint32_t ASSET_PACK_MAGIC = 0x4b505141; // "AQPK"
+const uint16_t ASSET_PACK_VERSION = 1;
+const size_t ASSET_PACK_ALIGNMENT = 4096;     // a page, so payloads can be used in place
+const size_t ASSET_NAME_LENGTH = 40;
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t entryCount;
+    uint32_t entrySize;
+    uint64_t indexChecksum;     // over the entries
+    uint64_t reserved;
+};
+
+struct AssetPackEntry {
+    char name[ASSET_NAME_LENGTH];   // NUL-terminated
+    uint64_t offset;                // from the start of the file
+    uint64_t size;
+    uint64_t checksum;              // snapshotChecksum of the payload
+};
+
+// Bytes of one asset, pointing into the pack's mapping.
+struct AssetView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+// Every shipped asset in one memory-mapped file, already decoded into the
+// form the renderers use, so a start with a pack decodes no images and reads
+// nothing but pages the assets occupy. Assets are used in place: views stay
+// valid until the pack is closed.
+class AssetPack {
+public:
+    // Maps the pack and checks its index; payloads are checked by find().
+    bool open(const char* path);
+    // Opens ASSET_PACK_FILE next to the executable, or else in the working
+    // directory, so a pack shipped with the program is found from anywhere.
+    bool openDefault();
+    void close();
+    bool isOpen() const { return file_.isOpen(); }
+
+    // Returns the asset, or an empty view if the pack has none by that name
+    // or its payload is damaged. Checksums the payload on every call, so
+    // look each asset up once.
+    AssetView find(const char* name) const;
+
+private:
+    MappedFile file_;
+    const AssetPackEntry* entries_ = nullptr;
+    uint32_t entryCount_ = 0;
+    std::string path_;
+};
+
+// Collects assets in memory and writes them as a pack.
+class AssetPackWriter {
+public:
+    void add(const char* name, const void* data, size_t size);
+    bool write(const char* path);
+
+private:
+    struct Asset {
+        std::string name;
+        std::vector<uint8_t> data;
+    };
+    std::vector<Asset> assets_;
+};
+
+// The pack opened at startup, if any; loaders fall back to the loose source
+// files without one.
+extern AssetPack assetPack;
+
+// Builds a pack from the source assets into `path` (--pack). Returns the
+// process exit code.
+int runAssetPackBuild(const char* path);
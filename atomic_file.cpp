@@ -0,0 +1,138 @@
+#include "atomic_file.h"
+
+#include <cstdio>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+AtomicFileWriter::~AtomicFileWriter() {
+    abandon();
+}
+
+#ifdef _WIN32
+
+bool AtomicFileWriter::open(const char* path) {
+    abandon();
+    path_ = path;
+    tmpPath_ = path_ + ".tmp";
+    HANDLE h = CreateFileA(tmpPath_.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (h == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open " << tmpPath_ << " for writing\n";
+        return false;
+    }
+    handle_ = h;
+    return true;
+}
+
+bool AtomicFileWriter::write(const void* data, size_t size) {
+    if (!handle_) return false;
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        DWORD chunk = size > (1u << 30) ? (1u << 30) : (DWORD)size;
+        DWORD written = 0;
+        if (!WriteFile((HANDLE)handle_, p, chunk, &written, nullptr) || written == 0) {
+            std::cerr << "Failed to write " << tmpPath_ << "\n";
+            abandon();
+            return false;
+        }
+        p += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool AtomicFileWriter::commit() {
+    if (!handle_) return false;
+    bool ok = FlushFileBuffers((HANDLE)handle_) != 0;
+    CloseHandle((HANDLE)handle_);
+    handle_ = nullptr;
+    if (ok) {
+        ok = MoveFileExA(tmpPath_.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+    }
+    if (!ok) {
+        std::cerr << "Failed to replace " << path_ << "\n";
+        DeleteFileA(tmpPath_.c_str());
+    }
+    return ok;
+}
+
+void AtomicFileWriter::abandon() {
+    if (handle_) {
+        CloseHandle((HANDLE)handle_);
+        handle_ = nullptr;
+        DeleteFileA(tmpPath_.c_str());
+    }
+}
+
+#else
+
+bool AtomicFileWriter::open(const char* path) {
+    abandon();
+    path_ = path;
+    tmpPath_ = path_ + ".tmp";
+    fd_ = ::open(tmpPath_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open " << tmpPath_ << " for writing\n";
+        return false;
+    }
+    return true;
+}
+
+bool AtomicFileWriter::write(const void* data, size_t size) {
+    if (fd_ < 0) return false;
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd_, p, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            std::cerr << "Failed to write " << tmpPath_ << "\n";
+            abandon();
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+bool AtomicFileWriter::commit() {
+    if (fd_ < 0) return false;
+    bool ok = fsync(fd_) == 0;
+    ok = (::close(fd_) == 0) && ok;
+    fd_ = -1;
+    if (ok) ok = std::rename(tmpPath_.c_str(), path_.c_str()) == 0;
+    if (!ok) {
+        std::cerr << "Failed to replace " << path_ << "\n";
+        ::unlink(tmpPath_.c_str());
+        return false;
+    }
+
+    // Persist the rename itself by syncing the containing directory.
+    size_t slash = path_.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : path_.substr(0, slash + 1);
+    int dirFd = ::open(dir.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+}
+
+void AtomicFileWriter::abandon() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+        ::unlink(tmpPath_.c_str());
+    }
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Writes a file crash-safely: data goes to "<path>.tmp", is flushed to disk,
+// and only then renamed over 'path'. Readers see either the old file or the
+// complete new one, never a partial write. An uncommitted writer removes its
+// temporary file on destruction.
+class AtomicFileWriter {
+public:
+    AtomicFileWriter() = default;
+    ~AtomicFileWriter();
+
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+    bool open(const char* path);
+    bool write(const void* data, size_t size);
+    // Flushes, syncs and renames over the target. The writer is closed afterwards.
+    bool commit();
+
+private:
+    void abandon();
+
+    std::string path_;
+    std::string tmpPath_;
+#ifdef _WIN32
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
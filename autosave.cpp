@@ -0,0 +1,79 @@
+#include "autosave.h"
+
+#include <iostream>
+
+#include "profiler.h"
+
+Autosave::~Autosave() {
+    stop();
+}
+
+void Autosave::start(const char* path, float interval) {
+    stop();
+    path_ = path;
+    interval_ = interval;
+    scheduled_ = false;
+    quit_ = false;
+    pending_ = false;
+    worker_ = std::thread(&Autosave::run, this);
+}
+
+void Autosave::reserve(size_t fishCount) {
+    // The worker only touches the buffers once a capture is pending.
+    std::lock_guard<std::mutex> lock(mutex_);
+    staging_.reserve(fishCount);
+    writing_.reserve(fishCount);
+}
+
+void Autosave::stop() {
+    if (!worker_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+void Autosave::update(float now, const std::vector<Fish>& fish, const std::vector<Fish>& leftOut,
+    const SnapshotLevels& levels) {
+    if (!worker_.joinable()) return;
+    if (!scheduled_) {
+        nextSave_ = now + interval_;
+        scheduled_ = true;
+    }
+    if (now < nextSave_ || pending_.load(std::memory_order_acquire)) return;
+
+    // The worker only holds the lock to swap buffers, but never wait for it
+    // from the render thread; try again next frame instead.
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+
+    PROFILE_SCOPE("Autosave capture");
+    staging_.assign(fish.begin(), fish.end());
+    staging_.insert(staging_.end(), leftOut.begin(), leftOut.end());
+    stagingLevels_ = levels;
+    pending_.store(true, std::memory_order_release);
+    lock.unlock();
+    wake_.notify_one();
+    nextSave_ = now + interval_;
+}
+
+void Autosave::run() {
+    PROFILE_THREAD_NAME("Autosave I/O");
+    for (;;) {
+        SnapshotLevels levels;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return quit_ || pending_.load(std::memory_order_acquire); });
+            if (quit_) return;
+            staging_.swap(writing_);
+            levels = stagingLevels_;
+            pending_.store(false, std::memory_order_release);
+        }
+        PROFILE_SCOPE("Autosave write");
+        if (!saveSnapshot(path_.c_str(), writing_.data(), writing_.size(), levels)) {
+            std::cerr << "Autosave to " << path_ << " failed\n";
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aquarium.h"
+#include "snapshot.h"
+
+const float AUTOSAVE_INTERVAL = 30.0f; // seconds
+
+// Periodic snapshot writer. The render thread copies the tank into a staging
+// buffer; a background thread swaps it out, serializes it and replaces the
+// snapshot file atomically. update() never waits on the I/O thread: if the
+// previous capture has not been picked up yet, the frame skips it.
+class Autosave {
+public:
+    ~Autosave();
+
+    void start(const char* path, float interval);
+    // Sizes the capture buffers for 'fishCount' fish, so that update() does
+    // not allocate for a tank that size; call after start().
+    void reserve(size_t fishCount);
+    // Stops the I/O thread after any write in progress has completed.
+    void stop();
+
+    // Call once per frame. Captures the tank when the interval has elapsed;
+    // 'leftOut' is saved after 'fish' (see applyFishBudget).
+    void update(float now, const std::vector<Fish>& fish, const std::vector<Fish>& leftOut,
+        const SnapshotLevels& levels);
+
+private:
+    void run();
+
+    std::string path_;
+    float interval_ = AUTOSAVE_INTERVAL;
+    float nextSave_ = 0.0f;
+    bool scheduled_ = false;
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> pending_{ false };
+    bool quit_ = false;
+
+    // staging_ belongs to the render thread while pending_ is false and to
+    // the worker while it is true; writing_ belongs to the worker.
+    std::vector<Fish> staging_;
+    std::vector<Fish> writing_;
+    SnapshotLevels stagingLevels_;
+};
@@ -0,0 +1,174 @@
+#include "background.h"
+
+#include <cmath>
+#include <iostream>
+
+#include "aquarium.h"
+#include "memory_budget.h"
+#include "perf_hud.h"
+#include "profiler.h"
+#include "render_queue.h"
+
+// Background shaders
+static const char* bgVertexShaderSrc = R"glsl(
+#version 330 core
+layout(location=0) in vec2 aPos;
+out vec2 vPos;
+
+void main() {
+    gl_Position = vec4(aPos, 0.0, 1.0);
+    vPos = aPos;
+}
+)glsl";
+
+static const char* bgFragmentShaderSrc = R"glsl(
+#version 330 core
+in vec2 vPos;
+out vec4 FragColor;
+
+uniform float u_time;
+uniform vec3 u_baseColor;
+uniform vec3 u_waveColor;
+uniform float u_resolution_x;
+uniform float u_resolution_y;
+
+void main() {
+    vec2 pos = vPos * vec2(u_resolution_x / u_resolution_y, 1.0);
+
+    // Simple wave effect
+    float wave1 = sin(pos.x * 5.0 + u_time * 0.5) * 0.1;
+    float wave2 = sin(pos.y * 3.0 + u_time * 0.3) * 0.05;
+    float wave_mix = (wave1 + wave2);
+
+    // Mix colors for a dynamic water effect
+    vec3 finalColor = mix(u_baseColor, u_waveColor, abs(wave_mix));
+
+    FragColor = vec4(finalColor, 1.0);
+}
+)glsl";
+
+// Stretches the low-resolution water over the viewport.
+static const char* compositeFragmentShaderSrc = R"glsl(
+#version 330 core
+in vec2 vPos;
+out vec4 FragColor;
+
+uniform sampler2D water;
+
+void main() {
+    FragColor = texture(water, vPos * 0.5 + 0.5);
+}
+)glsl";
+
+bool BackgroundPass::init() {
+    waveShader_ = createShaderProgram(bgVertexShaderSrc, bgFragmentShaderSrc);
+    compositeShader_ = createShaderProgram(bgVertexShaderSrc, compositeFragmentShaderSrc);
+
+    float bgQuad[] = {
+        -1.0f, -1.0f,
+         1.0f, -1.0f,
+         1.0f,  1.0f,
+        -1.0f,  1.0f,
+    };
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(bgQuad), bgQuad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    glUseProgram(waveShader_);
+    glUniform1f(glGetUniformLocation(waveShader_, "u_resolution_x"), (float)WINDOW_WIDTH);
+    glUniform1f(glGetUniformLocation(waveShader_, "u_resolution_y"), (float)WINDOW_HEIGHT);
+    glUniform3f(glGetUniformLocation(waveShader_, "u_waveColor"), 0.0f, 0.4f, 0.8f);
+    timeLoc_ = glGetUniformLocation(waveShader_, "u_time");
+    baseColorLoc_ = glGetUniformLocation(waveShader_, "u_baseColor");
+    glUseProgram(compositeShader_);
+    glUniform1i(glGetUniformLocation(compositeShader_, "water"), 0);
+    glUseProgram(0);
+
+    glGenFramebuffers(1, &fbo_);
+    glGenTextures(1, &texture_);
+    return true;
+}
+
+void BackgroundPass::shutdown() {
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &vbo_);
+    glDeleteProgram(waveShader_);
+    glDeleteProgram(compositeShader_);
+    glDeleteFramebuffers(1, &fbo_);
+    glDeleteTextures(1, &texture_);
+    memoryFreed(MEMORY_GPU_TEXTURES, textureBytes_);
+    vao_ = vbo_ = waveShader_ = compositeShader_ = fbo_ = texture_ = 0;
+    width_ = height_ = 0;
+    textureBytes_ = 0;
+    drawnColor_ = 0xffffffff;
+}
+
+bool BackgroundPass::resize(int width, int height) {
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Background framebuffer incomplete (0x" << std::hex << status << std::dec << ")\n";
+        return false;
+    }
+
+    memoryFreed(MEMORY_GPU_TEXTURES, textureBytes_);
+    textureBytes_ = (size_t)width * height * 4;
+    memoryAllocated(MEMORY_GPU_TEXTURES, textureBytes_);
+    width_ = width;
+    height_ = height;
+    return true;
+}
+
+void BackgroundPass::update(float time, float oxygen) {
+    // Dynamic background colors based on oxygen
+    float base_r = 0.0f;
+    float base_g = 0.3f + 0.7f * oxygen;
+    float base_b = 0.7f * oxygen + 0.2f;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int width = (viewport[2] + BACKGROUND_DOWNSCALE - 1) / BACKGROUND_DOWNSCALE;
+    int height = (viewport[3] + BACKGROUND_DOWNSCALE - 1) / BACKGROUND_DOWNSCALE;
+    uint32_t color = (uint32_t)std::lround(base_g * 255.0f) << 8 | (uint32_t)std::lround(base_b * 255.0f);
+    bool resized = width != width_ || height != height_;
+    if (!resized && color == drawnColor_ && ++framesSinceRedraw_ < BACKGROUND_REFRESH_FRAMES) return;
+
+    PROFILE_SCOPE("Background redraw");
+    GLint framebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    if (resized && !resize(width, height)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glViewport(0, 0, width_, height_);
+    glUseProgram(waveShader_);
+    glUniform1f(timeLoc_, time);
+    glUniform3f(baseColorLoc_, base_r, base_g, base_b);
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    countDrawCall();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    drawnColor_ = color;
+    framesSinceRedraw_ = 0;
+}
+
+void BackgroundPass::submit(RenderQueue& queue) {
+    queue.submit(LAYER_BACKGROUND, compositeShader_, texture_, vao_, GL_TRIANGLE_FAN, 0, 4);
+}
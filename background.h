@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+class RenderQueue;
+
+const int BACKGROUND_DOWNSCALE = 4;         // water texels per axis per window pixel: 1/4
+const int BACKGROUND_REFRESH_FRAMES = 3;    // redraw at least this often while colors hold
+
+// The animated water behind the fish. The waves are low-frequency, so they
+// are drawn into a texture at 1/BACKGROUND_DOWNSCALE of the viewport size
+// per axis and stretched over the viewport with bilinear filtering. The
+// texture is only redrawn when the oxygen-driven color changes by a visible
+// step or every BACKGROUND_REFRESH_FRAMES frames for the wave motion;
+// frames in between only pay for the upscale.
+class BackgroundPass {
+public:
+    bool init();
+    void shutdown();
+
+    // Redraws the water texture if it is due. Leaves the current
+    // framebuffer and viewport bound; the caller's state cache must be
+    // invalidated afterwards.
+    void update(float time, float oxygen);
+    // Queues the upscale into the current framebuffer.
+    void submit(RenderQueue& queue);
+
+    size_t textureBytes() const { return textureBytes_; }
+
+private:
+    bool resize(int width, int height);
+
+    GLuint waveShader_ = 0;
+    GLuint compositeShader_ = 0;
+    GLuint vao_ = 0, vbo_ = 0;
+    GLuint fbo_ = 0, texture_ = 0;
+    int width_ = 0, height_ = 0;
+    size_t textureBytes_ = 0;
+
+    GLint timeLoc_ = -1, baseColorLoc_ = -1;
+
+    uint32_t drawnColor_ = 0xffffffff;  // 8-bit base color of the texture's contents
+    int framesSinceRedraw_ = 0;
+};
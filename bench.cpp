@@ -0,0 +1,258 @@
+// Microbenchmarks for the simulation and rendering hot paths.
+//
+// Usage: aquarium_bench [--json <file>] [--max-fish <n>] [--assets <dir>] [--filter <text>]
+//
+// Each benchmark is calibrated to run for at least BENCH_MIN_SAMPLE_MS per
+// sample; the median of BENCH_SAMPLES samples is reported together with
+// ns per item, items per second and heap allocations per iteration. Results
+// are also written as JSON so runs can be compared over time.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "aquarium.h"
+#include "snapshot.h"
+#include "telemetry.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+const int BENCH_SAMPLES = 5;
+const double BENCH_MIN_SAMPLE_MS = 20.0;
+const char* const BENCH_TEMP_STATUS = "bench_status.tmp";
+const char* const BENCH_TEMP_SNAPSHOT = "bench_snapshot.tmp";
+
+// Allocation Counting
+static std::atomic<uint64_t> allocationCount{ 0 };
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+// Keeps the compiler from discarding a computed value.
+static volatile float benchSink;
+
+// Benchmark Runner
+struct BenchResult {
+    std::string name;
+    size_t items;
+    uint64_t iterations;
+    double nsPerIteration;
+    double allocationsPerIteration;
+};
+
+struct BenchOptions {
+    std::string jsonPath = "bench_results.json";
+    std::string assetDir = ".";
+    std::string filter;
+    size_t maxFish = 10000000;
+};
+
+static std::vector<BenchResult> results;
+static BenchOptions options;
+
+template <typename Body>
+static void runBenchmark(const std::string& name, size_t items, Body body) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+
+    using clock = std::chrono::steady_clock;
+    auto timeIterations = [&](uint64_t n) {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < n; i++) body();
+        return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    };
+
+    // Warm up, then grow the batch until one sample is long enough to time.
+    double ns = timeIterations(1);
+    uint64_t iterations = 1;
+    while (ns < BENCH_MIN_SAMPLE_MS * 1e6 && iterations < (1ull << 30)) {
+        iterations *= 2;
+        ns = timeIterations(iterations);
+    }
+
+    double samples[BENCH_SAMPLES];
+    uint64_t allocationsBefore = allocationCount.load();
+    for (double& sample : samples) sample = timeIterations(iterations) / iterations;
+    uint64_t allocations = allocationCount.load() - allocationsBefore;
+    std::sort(samples, samples + BENCH_SAMPLES);
+
+    BenchResult result;
+    result.name = name;
+    result.items = items;
+    result.iterations = iterations * BENCH_SAMPLES;
+    result.nsPerIteration = samples[BENCH_SAMPLES / 2];
+    result.allocationsPerIteration = (double)allocations / result.iterations;
+    results.push_back(result);
+
+    double nsPerItem = result.nsPerIteration / items;
+    printf("%-34s %12.1f ns/iter %10.3f ns/item %14.0f items/s %8.2f allocs/iter\n",
+        name.c_str(), result.nsPerIteration, nsPerItem, 1e9 / nsPerItem, result.allocationsPerIteration);
+    fflush(stdout);
+}
+
+static bool writeJson(const char* path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    file << "{\n  \"date\": \"" << date << "\",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        double nsPerItem = r.nsPerIteration / r.items;
+        file << "    {\"name\": \"" << r.name << "\", \"items\": " << r.items
+            << ", \"iterations\": " << r.iterations
+            << ", \"ns_per_iter\": " << r.nsPerIteration
+            << ", \"ns_per_item\": " << nsPerItem
+            << ", \"items_per_sec\": " << 1e9 / nsPerItem
+            << ", \"allocs_per_iter\": " << r.allocationsPerIteration << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    return (bool)file;
+}
+
+// Benchmarks
+static void benchSimulation() {
+    const float dt = 1.0f / 60.0f;
+    for (size_t count = 1000; count <= options.maxFish; count *= 10) {
+        std::string n = std::to_string(count);
+
+        srand(1);
+        runBenchmark("initFishes/" + n, count, [&] { initFishes((int)count); });
+
+        runBenchmark("updateFish/alive/" + n, count, [&] {
+            for (auto& f : fishes) updateFish(f, dt);
+        });
+
+        for (auto& f : fishes) f.isDying = true;
+        runBenchmark("updateFish/dying/" + n, count, [&] {
+            for (auto& f : fishes) updateFish(f, dt);
+        });
+
+        // Full step: level update plus the happiness decay and fish loop.
+        // Levels are reset every iteration so the tank never starts dying.
+        srand(1);
+        initFishes((int)count);
+        FishStats stats;
+        runBenchmark("stepSimulation/" + n, count, [&] {
+            oxygenLevel = 1.0f;
+            foodLevel = 0.5f;
+            areFishesDying = false;
+            stepSimulation(dt, stats);
+        });
+    }
+    fishes.clear();
+    fishes.shrink_to_fit();
+}
+
+static void benchText() {
+    std::vector<float> verts;
+    const char* labels[] = { "Food", "Give Oxygen", "REWIND  -12.3s   Left/Right: scrub   R: resume" };
+    for (const char* label : labels) {
+        size_t chars = std::strlen(label);
+        runBenchmark("layoutText/" + std::to_string(chars) + "chars", chars, [&] {
+            layoutText(30.0f, 60.0f, label, 1.5f, verts);
+        });
+    }
+}
+
+static void benchOrtho() {
+    float mat[16];
+    runBenchmark("ortho", 1, [&] {
+        ortho(0.0f, (float)WINDOW_WIDTH, (float)WINDOW_HEIGHT, 0.0f, -1.0f, 1.0f, mat);
+        benchSink = mat[0] + mat[13];
+    });
+}
+
+static void benchPersistence() {
+    float oxygen = 0.5f, food = 0.25f;
+    runBenchmark("saveStatus", 1, [&] { saveStatus(oxygen, food, BENCH_TEMP_STATUS); });
+    runBenchmark("loadStatus", 1, [&] { loadStatus(oxygen, food, BENCH_TEMP_STATUS); });
+    std::remove(BENCH_TEMP_STATUS);
+
+    size_t count = std::min<size_t>(1000000, options.maxFish);
+    srand(1);
+    initFishes((int)count);
+    SnapshotLevels levels;
+    std::vector<Fish> loaded;
+    runBenchmark("saveSnapshot/" + std::to_string(count), count, [&] {
+        saveSnapshot(BENCH_TEMP_SNAPSHOT, fishes.data(), fishes.size(), levels);
+    });
+    runBenchmark("loadSnapshot/" + std::to_string(count), count, [&] {
+        loadSnapshot(BENCH_TEMP_SNAPSHOT, loaded, levels);
+    });
+    std::remove(BENCH_TEMP_SNAPSHOT);
+    fishes.clear();
+    fishes.shrink_to_fit();
+}
+
+static void benchImageLoad() {
+    std::string path = options.assetDir + "/fish.png";
+    int w = 0, h = 0, channels = 0;
+    if (!stbi_info(path.c_str(), &w, &h, &channels)) {
+        std::cerr << "Skipping stbi_load: " << path << " not found (use --assets)\n";
+        return;
+    }
+    stbi_set_flip_vertically_on_load(true);
+    runBenchmark("stbi_load/fish.png", (size_t)w * h, [&] {
+        int tw, th, tc;
+        unsigned char* data = stbi_load(path.c_str(), &tw, &th, &tc, 0);
+        stbi_image_free(data);
+    });
+}
+
+static bool parseBenchOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--json") == 0 && hasValue) options.jsonPath = argv[++i];
+        else if (std::strcmp(arg, "--assets") == 0 && hasValue) options.assetDir = argv[++i];
+        else if (std::strcmp(arg, "--filter") == 0 && hasValue) options.filter = argv[++i];
+        else if (std::strcmp(arg, "--max-fish") == 0 && hasValue) options.maxFish = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--json <file>] [--max-fish <n>] [--assets <dir>] [--filter <text>]\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (!parseBenchOptions(argc, argv)) return -1;
+
+    benchSimulation();
+    benchText();
+    benchOrtho();
+    benchPersistence();
+    benchImageLoad();
+
+    if (!writeJson(options.jsonPath.c_str())) return -1;
+    std::cout << "Wrote " << results.size() << " results to " << options.jsonPath << "\n";
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "frame_arena.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "memory_budget.h"
+
+// Overflow blocks start with the link to the next one, padded so the space
+// after it is aligned like any malloc result.
+static const size_t OVERFLOW_HEADER = sizeof(std::max_align_t);
+
+// A block of `size` bytes with its pages already touched.
+static uint8_t* allocateBlock(size_t size) {
+    uint8_t* block = static_cast<uint8_t*>(std::malloc(size));
+    if (!block) throw std::bad_alloc();
+    std::memset(block, 0, size);
+    memoryAllocated(MEMORY_FRAME_ARENAS, size);
+    return block;
+}
+
+static void freeBlock(uint8_t* block, size_t size) {
+    std::free(block);
+    memoryFreed(MEMORY_FRAME_ARENAS, size);
+}
+
+FrameArena::FrameArena(size_t capacity) : block_(allocateBlock(capacity)), capacity_(capacity) {
+}
+
+FrameArena::~FrameArena() {
+    reset();
+    freeBlock(block_, capacity_);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    assert(alignment <= alignof(std::max_align_t) && (alignment & (alignment - 1)) == 0);
+    uintptr_t base = reinterpret_cast<uintptr_t>(block_);
+    uintptr_t start = (base + offset_ + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (start + size <= base + capacity_) {
+        offset_ = start + size - base;
+        return reinterpret_cast<void*>(start);
+    }
+
+    uint8_t* extra = static_cast<uint8_t*>(std::malloc(OVERFLOW_HEADER + size));
+    if (!extra) throw std::bad_alloc();
+    *reinterpret_cast<void**>(extra) = overflow_;
+    overflow_ = extra;
+    overflowBytes_ += size;
+    memoryAllocated(MEMORY_FRAME_ARENAS, size);
+    return extra + OVERFLOW_HEADER;
+}
+
+void FrameArena::reset() {
+    if (overflow_) {
+        while (overflow_) {
+            void* next = *static_cast<void**>(overflow_);
+            std::free(overflow_);
+            overflow_ = next;
+        }
+        memoryFreed(MEMORY_FRAME_ARENAS, overflowBytes_);
+        // Room for the frame that overflowed and a quarter more, so a scene
+        // that keeps growing slowly does not grow the arena every frame.
+        size_t capacity = (capacity_ + overflowBytes_) / 4 * 5;
+        freeBlock(block_, capacity_);
+        block_ = allocateBlock(capacity);
+        capacity_ = capacity;
+        overflowBytes_ = 0;
+    }
+    offset_ = 0;
+}
+
+FrameArena& frameArena() {
+    thread_local FrameArena arena;
+    return arena;
+}
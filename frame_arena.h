@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Debug builds count every operator new per thread, so frame loops can check
+// that steady-state frames leave the heap alone.
+#if !defined(NDEBUG) && !defined(AQ_COUNT_ALLOCATIONS)
+#define AQ_COUNT_ALLOCATIONS
+#endif
+
+const size_t FRAME_ARENA_CAPACITY = 256 * 1024;     // bytes reserved per thread up front
+const uint64_t FRAME_ARENA_WARMUP_FRAMES = 120;     // frames before the heap check starts
+
+// Linear allocator for data that only lives until the end of the frame:
+// allocating bumps an offset, freeing does nothing, and reset() makes the
+// whole arena available again. Every thread has its own (frameArena()), so
+// there is no lock; a thread running a frame loop resets its arena at the
+// end of each frame, and a worker resets its own once its job is done.
+//
+// A frame that needs more than the arena holds takes the rest from extra
+// blocks. The next reset replaces them with one block large enough for that
+// frame, so once frames settle no allocation reaches the heap. Blocks are
+// touched when created, so their pages do not fault in mid-frame.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity = FRAME_ARENA_CAPACITY);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment);
+    void reset();
+
+    size_t capacity() const { return capacity_; }
+    // Bytes handed out since the last reset, overflow included.
+    size_t used() const { return offset_ + overflowBytes_; }
+
+private:
+    uint8_t* block_ = nullptr;
+    size_t capacity_ = 0;
+    size_t offset_ = 0;
+    // Overflow blocks, chained through their first bytes so that growing the
+    // arena never needs a container of its own.
+    void* overflow_ = nullptr;
+    size_t overflowBytes_ = 0;
+};
+
+// The calling thread's arena.
+FrameArena& frameArena();
+
+// operator new calls made by the calling thread so far; always 0 without
+// AQ_COUNT_ALLOCATIONS. The counting replaces the global operator new, so it
+// lives in heap_check.cpp with FrameHeapCheck, and programs that count on
+// their own (the bench) link frame_arena.cpp alone.
+uint64_t threadHeapAllocations();
+
+// STL allocator on a frame arena, the calling thread's unless given one.
+// Containers using it must not outlive the arena's next reset.
+template <typename T>
+class FrameAllocator {
+public:
+    using value_type = T;
+
+    FrameAllocator() : arena_(&frameArena()) {}
+    explicit FrameAllocator(FrameArena& arena) : arena_(&arena) {}
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>& other) : arena_(other.arena()) {}
+
+    // Containers reassigned each frame take the arena along with the storage.
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    T* allocate(size_t n) { return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    FrameArena* arena() const { return arena_; }
+
+private:
+    FrameArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.arena() == b.arena(); }
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.arena() != b.arena(); }
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+// Per-frame bookkeeping for the thread running a frame loop: begin() and
+// end() bracket the work that must not allocate, and end() resets the
+// thread's arena. Past FRAME_ARENA_WARMUP_FRAMES, a bracket that reached the
+// heap fails an assertion in debug builds.
+class FrameHeapCheck {
+public:
+    void begin();
+    // Returns the heap allocations made since begin().
+    uint64_t end();
+
+private:
+    uint64_t frames_ = 0;
+    uint64_t start_ = 0;
+};
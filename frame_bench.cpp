@@ -0,0 +1,175 @@
+#include "frame_bench.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "aquarium.h"
+#include "frame_arena.h"
+#include "gpu_timer.h"
+#include "input_journal.h"
+#include "memory_budget.h"
+#include "offscreen_context.h"
+#include "perf_hud.h"
+#include "profiler.h"
+#include "renderer.h"
+#include "shader_cache.h"
+#include "software_renderer.h"
+#include "telemetry.h"
+
+// The scripted keeper feeds and adds oxygen every ten seconds for the first
+// part of each cycle, then stops until the tank starts dying, and revives it
+// when the next cycle begins. Every frame steps the simulation by one fixed
+// tick, so runs with the same arguments do identical work.
+static void applyScriptedInput(int frame) {
+    int cycleFrame = frame % FRAME_BENCH_CYCLE;
+    if (cycleFrame % 600 != 0 || cycleFrame >= 1800) return;
+    applyClick(feedButton.x + feedButton.width / 2, feedButton.y + feedButton.height / 2);
+    applyClick(oxygenButton.x + oxygenButton.width / 2, oxygenButton.y + oxygenButton.height / 2);
+}
+
+static void initBenchTank(int fishCount) {
+    srand(FRAME_BENCH_SEED);
+    initFishes(fishCount);
+    oxygenLevel = 1.0f;
+    foodLevel = 1.0f;
+    areFishesDying = false;
+    simulationTick = 0;
+}
+
+static int runSoftwareFrameBenchmark(int frames, int fishCount, int width, int height) {
+    SoftwareRenderer renderer;
+    if (!renderer.init(width, height)) return -1;
+    std::cout << "Frame benchmark on the software renderer (" << renderer.threads() << " threads, "
+        << width << "x" << height << ")\n";
+    initBenchTank(fishCount);
+
+    FishStats fishStats;
+    FrameHeapCheck heapCheck;
+    std::vector<float> cpuTimes;
+    cpuTimes.reserve(frames);
+    auto benchStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        auto frameStart = std::chrono::steady_clock::now();
+        PROFILE_SCOPE("Frame");
+        heapCheck.begin();
+        applyScriptedInput(frame);
+        stepSimulation(JOURNAL_FIXED_DT, fishStats);
+
+        RenderScene scene;
+        scene.fishes = &fishes;
+        scene.oxygen = oxygenLevel;
+        scene.food = foodLevel;
+        scene.time = frame * JOURNAL_FIXED_DT;
+        renderer.render(scene);
+        heapCheck.end();
+        cpuTimes.push_back(std::chrono::duration<float>(std::chrono::steady_clock::now() - frameStart).count());
+    }
+    float totalSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - benchStart).count();
+
+    std::cout << frames << " frames, " << fishes.size() << " fish, " << frames / totalSeconds << " frames/s\n";
+    printFrameTimeSummary("CPU frame time", cpuTimes);
+    printMemoryReport(std::cout);
+    return 0;
+}
+
+int runFrameBenchmark(int frames, int fishCount, int width, int height, bool software) {
+    PROFILE_THREAD_NAME("Main");
+    OffscreenContext context;
+    if (!software && !context.create()) {
+        std::cerr << "Benchmarking the software renderer instead\n";
+        software = true;
+    }
+    if (software) return runSoftwareFrameBenchmark(frames, fishCount, width, height);
+    std::cout << "Frame benchmark on " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")\n";
+
+    RenderTarget target;
+    if (!target.create(width, height)) return -1;
+    // Sets the viewport, which the renderer plans its texture budget by.
+    target.bind();
+    shaderCache.load(SHADER_CACHE_FILE);
+    Renderer renderer;
+    if (!renderer.init()) return -1;
+    shaderCache.flush();
+    renderer.finishLoading();
+    GpuTimer gpuTimer;
+    gpuTimer.init();
+
+    initBenchTank(fishCount);
+
+    FishStats fishStats;
+    FrameHeapCheck heapCheck;
+    std::vector<float> cpuTimes, gpuTimes;
+    cpuTimes.reserve(frames);
+    gpuTimes.reserve(frames);
+    GLsync inFlight[FRAME_BENCH_FRAMES_IN_FLIGHT] = {};
+    uint64_t collected = 0;
+
+    target.bind();
+    auto benchStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        // Without a swap chain nothing throttles the CPU, so wait for the
+        // frame that used this slot to finish, as presenting would.
+        GLsync& fence = inFlight[frame % FRAME_BENCH_FRAMES_IN_FLIGHT];
+        if (fence) {
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        auto frameStart = std::chrono::steady_clock::now();
+        PROFILE_SCOPE("Frame");
+        gpuTimer.beginFrame();
+        perfDrawCalls = 0;
+        perfStateChanges = 0;
+
+        heapCheck.begin();
+        applyScriptedInput(frame);
+        stepSimulation(JOURNAL_FIXED_DT, fishStats);
+
+        RenderScene scene;
+        scene.fishes = &fishes;
+        scene.oxygen = oxygenLevel;
+        scene.food = foodLevel;
+        scene.time = frame * JOURNAL_FIXED_DT;
+        renderer.render(scene, gpuTimer);
+
+        renderer.endFrame();
+        gpuTimer.endFrame();
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        heapCheck.end();
+        cpuTimes.push_back(std::chrono::duration<float>(std::chrono::steady_clock::now() - frameStart).count());
+
+        if (gpuTimer.collectedFrames() != collected) {
+            collected = gpuTimer.collectedFrames();
+            gpuTimes.push_back(gpuTimer.lastFrameMs() / 1000.0f);
+        }
+    }
+    glFinish();
+    float totalSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - benchStart).count();
+
+    std::cout << frames << " frames, " << fishes.size() << " fish, " << perfDrawCalls << " draw calls and "
+        << perfStateChanges << " binds/frame, "
+        << frames / totalSeconds << " frames/s\n";
+    printFrameTimeSummary("CPU frame time", cpuTimes);
+    printFrameTimeSummary("GPU frame time", gpuTimes);
+    if ((int)gpuTimes.size() < frames) {
+        std::cout << frames - (int)gpuTimes.size() << " frames without GPU timings (still in flight or skipped)\n";
+    }
+    for (int i = 0; i < gpuTimer.passCount(); i++) {
+        const GpuPassStats& pass = gpuTimer.pass(i);
+        std::cout << "  " << pass.name << ": avg " << pass.average() << " ms  max " << pass.maximum()
+            << " ms (last " << pass.count << " frames)\n";
+    }
+    printMemoryReport(std::cout);
+
+    for (GLsync fence : inFlight) {
+        if (fence) glDeleteSync(fence);
+    }
+    gpuTimer.shutdown();
+    renderer.shutdown();
+    target.destroy();
+    return 0;
+}
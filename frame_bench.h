@@ -0,0 +1,13 @@
+#pragma once
+
+const int FRAME_BENCH_DEFAULT_FISH = 1000;
+const int FRAME_BENCH_FRAMES_IN_FLIGHT = 2;    // like a double-buffered swap chain
+const int FRAME_BENCH_CYCLE = 3000;            // frames before the scripted scenario repeats
+const unsigned FRAME_BENCH_SEED = 12345;
+
+// Renders `frames` frames of a scripted scenario with `fishCount` fish into
+// a width x height offscreen framebuffer, without a window, and prints the
+// CPU and GPU frame-time distributions. With `software`, the frames are drawn
+// by the SoftwareRenderer and only CPU times are printed. Returns the
+// process exit code.
+int runFrameBenchmark(int frames, int fishCount, int width, int height, bool software);
@@ -0,0 +1,301 @@
+#include "frame_encoder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "profiler.h"
+
+// Pixel Conversion
+
+// BT.601 studio range, the default for Y4M players.
+static inline uint8_t lumaOf(const uint8_t* p) {
+    return (uint8_t)(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+}
+
+// Converts one bottom-up RGBA frame into top-down Y, U and V planes with
+// chroma averaged over 2x2 blocks.
+static void rgbaToI420(const uint8_t* rgba, int width, int height, uint8_t* out) {
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    uint8_t* yPlane = out;
+    uint8_t* uPlane = yPlane + (size_t)width * height;
+    uint8_t* vPlane = uPlane + (size_t)chromaWidth * chromaHeight;
+    size_t stride = (size_t)width * 4;
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = rgba + (height - 1 - y) * stride;
+        uint8_t* dst = yPlane + (size_t)y * width;
+        for (int x = 0; x < width; x++) dst[x] = lumaOf(row + x * 4);
+    }
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        int y0 = cy * 2;
+        int y1 = y0 + 1 < height ? y0 + 1 : y0;
+        const uint8_t* row0 = rgba + (height - 1 - y0) * stride;
+        const uint8_t* row1 = rgba + (height - 1 - y1) * stride;
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            int x0 = cx * 2 * 4;
+            int x1 = cx * 2 + 1 < width ? x0 + 4 : x0;
+            int r = row0[x0] + row0[x1] + row1[x0] + row1[x1];
+            int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+            int b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+            // Sums of four samples: scale the >> 8 by another >> 2.
+            uPlane[(size_t)cy * chromaWidth + cx] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+            vPlane[(size_t)cy * chromaWidth + cx] = (uint8_t)(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+        }
+    }
+}
+
+// PNG
+
+static uint32_t crcTable[256];
+
+static void initCrcTable() {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+}
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void putBigEndian(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+static void putChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+    putBigEndian(out, (uint32_t)size);
+    size_t typeAt = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    uint32_t crc = crc32Update(0xFFFFFFFFu, out.data() + typeAt, size + 4);
+    putBigEndian(out, crc ^ 0xFFFFFFFFu);
+}
+
+// Builds an RGB PNG from a bottom-up RGBA frame. The image data is stored in
+// uncompressed deflate blocks: frames are written as fast as the disk takes
+// them and can be recompressed offline by whatever consumes the sequence.
+static void encodePng(const uint8_t* rgba, int width, int height, std::vector<uint8_t>& raw, std::vector<uint8_t>& out) {
+    size_t rowBytes = (size_t)width * 3 + 1;
+    raw.resize(rowBytes * height);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = rgba + (size_t)(height - 1 - y) * width * 4;
+        uint8_t* dst = raw.data() + y * rowBytes;
+        *dst++ = 0; // filter: none
+        for (int x = 0; x < width; x++) {
+            dst[x * 3 + 0] = src[x * 4 + 0];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+
+    std::vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    uint32_t a = 1, b = 0;
+    for (size_t at = 0; at < raw.size();) {
+        size_t len = raw.size() - at < 65535 ? raw.size() - at : 65535;
+        zlib.push_back(at + len == raw.size() ? 1 : 0);
+        zlib.push_back((uint8_t)len);
+        zlib.push_back((uint8_t)(len >> 8));
+        zlib.push_back((uint8_t)~len);
+        zlib.push_back((uint8_t)(~len >> 8));
+        zlib.insert(zlib.end(), raw.begin() + at, raw.begin() + at + len);
+        // Adler-32, reduced once per block; 65535 bytes cannot overflow b.
+        for (size_t i = at; i < at + len; i++) {
+            a += raw[i];
+            b += a;
+            if (a >= 65521) a -= 65521;
+        }
+        b %= 65521;
+        at += len;
+    }
+    putBigEndian(zlib, (b << 16) | a);
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.assign(signature, signature + 8);
+    uint8_t header[13] = {};
+    header[0] = (uint8_t)(width >> 24); header[1] = (uint8_t)(width >> 16);
+    header[2] = (uint8_t)(width >> 8);  header[3] = (uint8_t)width;
+    header[4] = (uint8_t)(height >> 24); header[5] = (uint8_t)(height >> 16);
+    header[6] = (uint8_t)(height >> 8);  header[7] = (uint8_t)height;
+    header[8] = 8;  // bit depth
+    header[9] = 2;  // color type: RGB
+    putChunk(out, "IHDR", header, sizeof(header));
+    putChunk(out, "IDAT", zlib.data(), zlib.size());
+    putChunk(out, "IEND", nullptr, 0);
+}
+
+// FrameEncoder
+
+// Counts the frame-number conversions in a PNG path pattern. Returns -1 if
+// the pattern has a % that is not %%, %d or %0Nd, since the pattern is
+// passed to snprintf.
+static int framePatternConversions(const std::string& pattern) {
+    int conversions = 0;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern[i] != '%') continue;
+        size_t end = i + 1;
+        if (end < pattern.size() && pattern[end] == '%') {
+            i = end;
+            continue;
+        }
+        if (end < pattern.size() && pattern[end] == '0') {
+            end++;
+            size_t digits = end;
+            while (end < pattern.size() && pattern[end] >= '0' && pattern[end] <= '9') end++;
+            if (end == digits || end - digits > 2) return -1;
+        }
+        if (end >= pattern.size() || pattern[end] != 'd') return -1;
+        conversions++;
+        i = end;
+    }
+    return conversions;
+}
+
+FrameEncoder::~FrameEncoder() {
+    stop();
+}
+
+bool FrameEncoder::start(const char* path, FrameFormat format, int width, int height, int fps) {
+    stop();
+    format_ = format;
+    path_ = path;
+    width_ = width;
+    height_ = height;
+    framesWritten_ = 0;
+    failed_ = false;
+    stallSeconds_ = 0.0;
+    quit_ = false;
+
+    if (format == FRAME_FORMAT_Y4M) {
+        stream_.open(path, std::ios::binary | std::ios::trunc);
+        if (!stream_) {
+            std::cerr << "Failed to open " << path << " for writing\n";
+            return false;
+        }
+        char header[96];
+        snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+        stream_ << header;
+    }
+    else {
+        initCrcTable();
+        int conversions = framePatternConversions(path_);
+        if (conversions < 0 || conversions > 1) {
+            std::cerr << "Export path " << path << " needs at most one %d or %0Nd; write %% for a literal %\n";
+            return false;
+        }
+        if (conversions == 0) {
+            size_t dot = path_.rfind('.');
+            path_.insert(dot == std::string::npos ? path_.size() : dot, "_%06d");
+        }
+    }
+
+    buffers_.assign(FRAME_ENCODER_BUFFERS, std::vector<uint8_t>((size_t)width * height * 4));
+    free_.clear();
+    queued_.clear();
+    for (auto& buffer : buffers_) free_.push_back(buffer.data());
+    worker_ = std::thread(&FrameEncoder::run, this);
+    return true;
+}
+
+bool FrameEncoder::stop() {
+    if (!worker_.joinable()) return !failed_;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+    if (stream_.is_open()) {
+        stream_.close();
+        if (!stream_) failed_ = true;
+    }
+    buffers_.clear();
+    return !failed_;
+}
+
+uint8_t* FrameEncoder::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        PROFILE_SCOPE("Encoder stall");
+        auto start = std::chrono::steady_clock::now();
+        released_.wait(lock, [this] { return !free_.empty(); });
+        stallSeconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    uint8_t* frame = free_.back();
+    free_.pop_back();
+    return frame;
+}
+
+void FrameEncoder::submit(uint8_t* frame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_.push_back(frame);
+    }
+    wake_.notify_one();
+}
+
+void FrameEncoder::run() {
+    PROFILE_THREAD_NAME("Frame encoder");
+    uint64_t index = 0;
+    for (;;) {
+        uint8_t* frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return quit_ || !queued_.empty(); });
+            if (queued_.empty()) return;
+            frame = queued_.front();
+            queued_.pop_front();
+        }
+        // After a failed write keep draining so the render thread never blocks.
+        if (!failed_) {
+            PROFILE_SCOPE("Encode frame");
+            bool ok = format_ == FRAME_FORMAT_Y4M ? writeY4m(frame) : writePng(frame, index);
+            if (!ok) failed_ = true;
+            else framesWritten_++;
+        }
+        index++;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(frame);
+        }
+        released_.notify_one();
+    }
+}
+
+bool FrameEncoder::writeY4m(const uint8_t* rgba) {
+    size_t chroma = (size_t)((width_ + 1) / 2) * ((height_ + 1) / 2);
+    scratch_.resize((size_t)width_ * height_ + chroma * 2);
+    rgbaToI420(rgba, width_, height_, scratch_.data());
+    stream_.write("FRAME\n", 6);
+    stream_.write((const char*)scratch_.data(), scratch_.size());
+    if (!stream_) {
+        std::cerr << "Failed to write frame to " << path_ << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool FrameEncoder::writePng(const uint8_t* rgba, uint64_t index) {
+    encodePng(rgba, width_, height_, pngRows_, scratch_);
+
+    char name[1024];
+    snprintf(name, sizeof(name), path_.c_str(), (int)index);
+    std::ofstream file(name, std::ios::binary | std::ios::trunc);
+    file.write((const char*)scratch_.data(), scratch_.size());
+    if (!file) {
+        std::cerr << "Failed to write " << name << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int FRAME_ENCODER_BUFFERS = 8; // frames that may wait for the encoder
+
+enum FrameFormat {
+    FRAME_FORMAT_Y4M,   // one raw YUV 4:2:0 stream
+    FRAME_FORMAT_PNG,   // one uncompressed RGB PNG per frame
+};
+
+// Writes rendered frames on a background thread. Frames are bottom-up RGBA8,
+// exactly as glReadPixels returns them; the encoder flips and converts them.
+// The render thread fills a buffer from acquire() and passes it to submit();
+// acquire() only blocks once FRAME_ENCODER_BUFFERS frames are queued.
+class FrameEncoder {
+public:
+    ~FrameEncoder();
+
+    // For PNG, `path` is a pattern for the frame number, such as
+    // "frames/tank_%05d.png": one %d or %0Nd, added before the extension if
+    // missing, and %% for a literal percent sign. Any other % is rejected.
+    bool start(const char* path, FrameFormat format, int width, int height, int fps);
+    // Writes every submitted frame, then stops the thread.
+    // Returns false if any write failed.
+    bool stop();
+
+    uint8_t* acquire();
+    void submit(uint8_t* frame);
+
+    uint64_t framesWritten() const { return framesWritten_; }
+    // Time the render thread spent waiting for a free buffer.
+    double stallSeconds() const { return stallSeconds_; }
+
+private:
+    void run();
+    bool writeY4m(const uint8_t* rgba);
+    bool writePng(const uint8_t* rgba, uint64_t index);
+
+    FrameFormat format_ = FRAME_FORMAT_Y4M;
+    std::string path_;
+    int width_ = 0;
+    int height_ = 0;
+    std::ofstream stream_;
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wake_;      // worker: a frame was queued or stop requested
+    std::condition_variable released_;  // render thread: a buffer became free
+    std::vector<std::vector<uint8_t>> buffers_;
+    std::vector<uint8_t*> free_;
+    std::deque<uint8_t*> queued_;
+    bool quit_ = false;
+
+    // Owned by the worker; read by the render thread after stop().
+    std::vector<uint8_t> scratch_;
+    std::vector<uint8_t> pngRows_;
+    uint64_t framesWritten_ = 0;
+    bool failed_ = false;
+
+    // Owned by the render thread.
+    double stallSeconds_ = 0.0;
+};
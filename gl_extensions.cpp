@@ -0,0 +1,49 @@
+#include "gl_extensions.h"
+
+#include <cstring>
+
+GLExtensions glExt;
+
+bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && std::strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
+
+static bool hasVersion(int major, int minor) {
+    GLint actualMajor = 0, actualMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &actualMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &actualMinor);
+    return actualMajor > major || (actualMajor == major && actualMinor >= minor);
+}
+
+void loadGLExtensions(GLADloadproc load) {
+    glExt = GLExtensions();
+    if (hasVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage")) {
+        glExt.BufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+        glExt.bufferStorage = glExt.BufferStorage != nullptr;
+    }
+
+    // Drivers may expose the entry points and still offer no format to save in.
+    GLint binaryFormats = 0;
+    if (hasVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary")) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+        glExt.GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+        glExt.ProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+        glExt.ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+        glExt.programBinary = binaryFormats > 0 && glExt.GetProgramBinary && glExt.ProgramBinary && glExt.ProgramParameteri;
+    }
+
+    // Both extensions share their tokens; only the entry point's suffix differs.
+    if (hasGLExtension("GL_KHR_parallel_shader_compile")) {
+        glExt.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+    }
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile")) {
+        glExt.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+    }
+    glExt.parallelShaderCompile = glExt.MaxShaderCompilerThreads != nullptr;
+}
@@ -0,0 +1,189 @@
+#include "gorilla.h"
+
+#include <cstring>
+
+void BitWriter::write(uint64_t bits, int count) {
+    // Split wide writes so the accumulator never holds more than 64 bits.
+    if (count > 32) {
+        write(bits >> 32, count - 32);
+        bits &= 0xFFFFFFFFull;
+        count = 32;
+    }
+    if (count < 64) bits &= (1ull << count) - 1;
+    acc_ = (acc_ << count) | bits;
+    accBits_ += count;
+    while (accBits_ >= 8) {
+        accBits_ -= 8;
+        bytes_.push_back((uint8_t)(acc_ >> accBits_));
+    }
+}
+
+const std::vector<uint8_t>& BitWriter::finish() {
+    if (accBits_ > 0) {
+        bytes_.push_back((uint8_t)(acc_ << (8 - accBits_)));
+        accBits_ = 0;
+    }
+    acc_ = 0;
+    return bytes_;
+}
+
+void BitWriter::clear() {
+    bytes_.clear();
+    acc_ = 0;
+    accBits_ = 0;
+}
+
+bool BitReader::read(int count, uint64_t& bits) {
+    if (bitPos_ + (size_t)count > size_ * 8) return false;
+    bits = 0;
+    for (int i = 0; i < count; i++) {
+        size_t byte = bitPos_ >> 3;
+        int shift = 7 - (int)(bitPos_ & 7);
+        bits = (bits << 1) | ((data_[byte] >> shift) & 1);
+        bitPos_++;
+    }
+    return true;
+}
+
+static uint64_t signExtend(uint64_t v, int bits) {
+    uint64_t sign = 1ull << (bits - 1);
+    return (v ^ sign) - sign;
+}
+
+void encodeIntColumn(const int64_t* values, size_t count, BitWriter& out) {
+    if (count == 0) return;
+    out.write((uint64_t)values[0], 64);
+    // Unsigned arithmetic so extreme values wrap instead of overflowing.
+    uint64_t prevDelta = 0;
+    for (size_t i = 1; i < count; i++) {
+        uint64_t delta = (uint64_t)values[i] - (uint64_t)values[i - 1];
+        int64_t dod = (int64_t)(delta - prevDelta);
+        prevDelta = delta;
+        if (dod == 0) {
+            out.write(0, 1);
+        }
+        else if (dod >= -64 && dod <= 63) {
+            out.write(0x2, 2);
+            out.write((uint64_t)dod, 7);
+        }
+        else if (dod >= -256 && dod <= 255) {
+            out.write(0x6, 3);
+            out.write((uint64_t)dod, 9);
+        }
+        else if (dod >= -2048 && dod <= 2047) {
+            out.write(0xE, 4);
+            out.write((uint64_t)dod, 12);
+        }
+        else {
+            out.write(0xF, 4);
+            out.write((uint64_t)dod, 64);
+        }
+    }
+}
+
+bool decodeIntColumn(BitReader& in, size_t count, int64_t* values) {
+    if (count == 0) return true;
+    uint64_t bits;
+    if (!in.read(64, bits)) return false;
+    values[0] = (int64_t)bits;
+    uint64_t prevDelta = 0;
+    for (size_t i = 1; i < count; i++) {
+        int prefix = 0;
+        uint64_t bit;
+        while (prefix < 4) {
+            if (!in.read(1, bit)) return false;
+            if (!bit) break;
+            prefix++;
+        }
+        static const int widths[5] = { 0, 7, 9, 12, 64 };
+        uint64_t dod = 0;
+        if (prefix > 0) {
+            if (!in.read(widths[prefix], bits)) return false;
+            dod = prefix == 4 ? bits : signExtend(bits, widths[prefix]);
+        }
+        prevDelta += dod;
+        values[i] = (int64_t)((uint64_t)values[i - 1] + prevDelta);
+    }
+    return true;
+}
+
+static uint32_t floatBits(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, 4);
+    return u;
+}
+
+static int countLeadingZeros32(uint32_t v) {
+    int n = 0;
+    for (uint32_t mask = 0x80000000u; mask && !(v & mask); mask >>= 1) n++;
+    return n;
+}
+
+static int countTrailingZeros32(uint32_t v) {
+    int n = 0;
+    for (uint32_t mask = 1u; mask && !(v & mask); mask <<= 1) n++;
+    return n;
+}
+
+void encodeFloatColumn(const float* values, size_t count, BitWriter& out) {
+    if (count == 0) return;
+    uint32_t prev = floatBits(values[0]);
+    out.write(prev, 32);
+    int prevLeading = -1;
+    int prevTrailing = 0;
+    for (size_t i = 1; i < count; i++) {
+        uint32_t cur = floatBits(values[i]);
+        uint32_t x = cur ^ prev;
+        prev = cur;
+        if (x == 0) {
+            out.write(0, 1);
+            continue;
+        }
+        int leading = countLeadingZeros32(x);
+        int trailing = countTrailingZeros32(x);
+        if (leading > 31) leading = 31;
+        if (prevLeading >= 0 && leading >= prevLeading && trailing >= prevTrailing) {
+            // Fits in the previous window.
+            out.write(0x2, 2);
+            out.write(x >> prevTrailing, 32 - prevLeading - prevTrailing);
+        }
+        else {
+            int meaningful = 32 - leading - trailing;
+            out.write(0x3, 2);
+            out.write((uint64_t)leading, 5);
+            out.write((uint64_t)(meaningful - 1), 5);
+            out.write(x >> trailing, meaningful);
+            prevLeading = leading;
+            prevTrailing = trailing;
+        }
+    }
+}
+
+bool decodeFloatColumn(BitReader& in, size_t count, float* values) {
+    if (count == 0) return true;
+    uint64_t bits;
+    if (!in.read(32, bits)) return false;
+    uint32_t prev = (uint32_t)bits;
+    std::memcpy(&values[0], &prev, 4);
+    int leading = 0;
+    int trailing = 0;
+    for (size_t i = 1; i < count; i++) {
+        uint64_t bit;
+        if (!in.read(1, bit)) return false;
+        if (bit) {
+            if (!in.read(1, bit)) return false;
+            if (bit) {
+                uint64_t lead, len;
+                if (!in.read(5, lead) || !in.read(5, len)) return false;
+                leading = (int)lead;
+                trailing = 32 - leading - (int)(len + 1);
+                if (trailing < 0) return false;
+            }
+            int meaningful = 32 - leading - trailing;
+            if (!in.read(meaningful, bits)) return false;
+            prev ^= (uint32_t)(bits << trailing);
+        }
+        std::memcpy(&values[i], &prev, 4);
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Gorilla-style column codecs (Pelkonen et al., "Gorilla: A Fast, Scalable,
+// In-Memory Time Series Database"). Integers are stored as delta-of-delta in
+// variable-width buckets, floats as the XOR with the previous value using a
+// leading/trailing-zero window. A slowly changing column costs one or two
+// bits per sample.
+
+class BitWriter {
+public:
+    void write(uint64_t bits, int count);
+    void writeBit(bool bit) { write(bit ? 1 : 0, 1); }
+    // Pads to a whole byte and returns the packed bytes.
+    const std::vector<uint8_t>& finish();
+    void clear();
+
+private:
+    std::vector<uint8_t> bytes_;
+    uint64_t acc_ = 0;
+    int accBits_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+    bool read(int count, uint64_t& bits);
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t bitPos_ = 0;
+};
+
+void encodeIntColumn(const int64_t* values, size_t count, BitWriter& out);
+bool decodeIntColumn(BitReader& in, size_t count, int64_t* values);
+
+void encodeFloatColumn(const float* values, size_t count, BitWriter& out);
+bool decodeFloatColumn(BitReader& in, size_t count, float* values);
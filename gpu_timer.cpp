@@ -0,0 +1,141 @@
+#include "gpu_timer.h"
+
+// GpuPassStats
+
+void GpuPassStats::add(float ms) {
+    samples[head] = ms;
+    head = (head + 1) % GPU_TIMER_HISTORY;
+    if (count < GPU_TIMER_HISTORY) count++;
+}
+
+float GpuPassStats::average() const {
+    if (count == 0) return 0.0f;
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++) sum += samples[i];
+    return sum / count;
+}
+
+float GpuPassStats::maximum() const {
+    float m = 0.0f;
+    for (int i = 0; i < count; i++) {
+        if (samples[i] > m) m = samples[i];
+    }
+    return m;
+}
+
+// GpuTimer
+
+void GpuTimer::init() {
+    for (FrameSlot& slot : slots_) {
+        glGenQueries(GPU_TIMER_MAX_ZONES * 2, slot.queries);
+        slot.zoneCount = 0;
+        slot.pending = false;
+    }
+    track_ = profilerCreateTrack("GPU");
+    syncClocks();
+    initialized_ = true;
+}
+
+void GpuTimer::shutdown() {
+    if (!initialized_) return;
+    for (FrameSlot& slot : slots_) {
+        glDeleteQueries(GPU_TIMER_MAX_ZONES * 2, slot.queries);
+    }
+    initialized_ = false;
+}
+
+void GpuTimer::syncClocks() {
+    // Reading GL_TIMESTAMP returns the GPU clock once previous commands have
+    // been submitted, without waiting for them to finish.
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuSyncNanos_ = gpuNow;
+    cpuSyncNanos_ = profilerSteadyNanos();
+}
+
+void GpuTimer::beginFrame() {
+    if (!initialized_) return;
+    // Re-sync every few seconds so drift between the clocks stays small.
+    if (frameIndex_++ % 256 == 0) syncClocks();
+
+    current_ = (current_ + 1) % GPU_TIMER_LATENCY;
+    FrameSlot& slot = slots_[current_];
+    if (slot.pending) collect(slot);
+    slot.zoneCount = 0;
+    slot.pending = false;
+    openZone_ = -1;
+}
+
+void GpuTimer::endFrame() {
+    if (!initialized_) return;
+    FrameSlot& slot = slots_[current_];
+    slot.pending = slot.zoneCount > 0;
+}
+
+int GpuTimer::begin(const char* name) {
+    if (!initialized_) return -1;
+    FrameSlot& slot = slots_[current_];
+    if (slot.zoneCount >= GPU_TIMER_MAX_ZONES) return -1;
+    int zone = slot.zoneCount++;
+    slot.zones[zone].name = name;
+    slot.zones[zone].parent = openZone_;
+    openZone_ = zone;
+    glQueryCounter(slot.queries[zone * 2], GL_TIMESTAMP);
+    return zone;
+}
+
+void GpuTimer::end(int zone) {
+    if (zone < 0) return;
+    FrameSlot& slot = slots_[current_];
+    glQueryCounter(slot.queries[zone * 2 + 1], GL_TIMESTAMP);
+    openZone_ = slot.zones[zone].parent;
+}
+
+void GpuTimer::collect(FrameSlot& slot) {
+    // If any result is still outstanding the GPU is more than
+    // GPU_TIMER_LATENCY frames behind; drop this frame instead of stalling.
+    for (int i = 0; i < slot.zoneCount; i++) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(slot.queries[i * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+    }
+
+    uint64_t frameStart = 0, frameEnd = 0;
+    for (int i = 0; i < slot.zoneCount; i++) {
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(slot.queries[i * 2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+        if (end < start) continue;
+
+        passStats(slot.zones[i].name).add((end - start) / 1e6f);
+        if (frameStart == 0 || start < frameStart) frameStart = start;
+        if (end > frameEnd) frameEnd = end;
+
+        int64_t startOffset = (int64_t)start - gpuSyncNanos_;
+        int64_t endOffset = (int64_t)end - gpuSyncNanos_;
+        if ((int64_t)cpuSyncNanos_ + startOffset >= 0) {
+            profilerRecordOn(track_, slot.zones[i].name, cpuSyncNanos_ + startOffset, cpuSyncNanos_ + endOffset);
+        }
+    }
+    lastFrameMs_ = (frameEnd - frameStart) / 1e6f;
+    collectedFrames_++;
+}
+
+GpuPassStats& GpuTimer::passStats(const char* name) {
+    for (int i = 0; i < passCount_; i++) {
+        if (passes_[i].name == name) return passes_[i];
+    }
+    if (passCount_ < GPU_TIMER_MAX_PASSES) {
+        passes_[passCount_].name = name;
+        return passes_[passCount_++];
+    }
+    // Out of slots; fold extra passes into the last one.
+    return passes_[GPU_TIMER_MAX_PASSES - 1];
+}
+
+const GpuPassStats* GpuTimer::stats(const char* name) const {
+    for (int i = 0; i < passCount_; i++) {
+        if (passes_[i].name == name) return &passes_[i];
+    }
+    return nullptr;
+}
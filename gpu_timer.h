@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+
+#include "profiler.h"
+
+const int GPU_TIMER_LATENCY = 4;        // frames between issuing and reading a query
+const int GPU_TIMER_MAX_ZONES = 32;     // zones per frame
+const int GPU_TIMER_MAX_PASSES = 16;    // distinct zone names with statistics
+const int GPU_TIMER_HISTORY = 120;      // frames of rolling statistics per pass
+
+// Rolling GPU time of one named pass, in milliseconds.
+struct GpuPassStats {
+    const char* name = nullptr;
+    float samples[GPU_TIMER_HISTORY] = {};
+    int count = 0;
+    int head = 0;
+
+    void add(float ms);
+    float average() const;
+    float maximum() const;
+    float last() const { return count ? samples[(head + GPU_TIMER_HISTORY - 1) % GPU_TIMER_HISTORY] : 0.0f; }
+};
+
+// Times GPU passes with GL_TIMESTAMP queries. Each zone writes a timestamp
+// at its start and end into a ring of GPU_TIMER_LATENCY frames of query
+// objects; a frame's results are collected when its slot comes round again,
+// and skipped rather than waited for if the GPU is still behind. Results
+// feed per-pass rolling statistics and a "GPU" track in the profiler trace,
+// aligned to the CPU timeline with a periodic GL_TIMESTAMP clock sync.
+class GpuTimer {
+public:
+    void init();
+    void shutdown();
+
+    void beginFrame();
+    void endFrame();
+
+    // Returns a zone index for end(), or -1 when out of queries.
+    int begin(const char* name);
+    void end(int zone);
+
+    const GpuPassStats* stats(const char* name) const;
+    int passCount() const { return passCount_; }
+    const GpuPassStats& pass(int i) const { return passes_[i]; }
+    // Total GPU time of the most recently collected frame, in milliseconds.
+    float lastFrameMs() const { return lastFrameMs_; }
+    // Frames whose results have been read back; frames skipped because the
+    // GPU fell behind are not counted.
+    uint64_t collectedFrames() const { return collectedFrames_; }
+
+private:
+    struct Zone {
+        const char* name;
+        int parent;
+    };
+    struct FrameSlot {
+        GLuint queries[GPU_TIMER_MAX_ZONES * 2];
+        Zone zones[GPU_TIMER_MAX_ZONES];
+        int zoneCount = 0;
+        bool pending = false;
+    };
+
+    void collect(FrameSlot& slot);
+    void syncClocks();
+    GpuPassStats& passStats(const char* name);
+
+    FrameSlot slots_[GPU_TIMER_LATENCY];
+    int current_ = 0;
+    int openZone_ = -1;
+    bool initialized_ = false;
+    uint64_t frameIndex_ = 0;
+
+    // GPU clock value and matching profiler time from the last sync.
+    int64_t gpuSyncNanos_ = 0;
+    uint64_t cpuSyncNanos_ = 0;
+
+    GpuPassStats passes_[GPU_TIMER_MAX_PASSES];
+    int passCount_ = 0;
+    float lastFrameMs_ = 0.0f;
+    uint64_t collectedFrames_ = 0;
+    ProfileThreadBuffer* track_ = nullptr;
+};
+
+class GpuZone {
+public:
+    GpuZone(GpuTimer& timer, const char* name) : timer_(timer), zone_(timer.begin(name)) {}
+    ~GpuZone() { timer_.end(zone_); }
+
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+
+private:
+    GpuTimer& timer_;
+    int zone_;
+};
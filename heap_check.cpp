@@ -0,0 +1,105 @@
+#include "frame_arena.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifdef AQ_COUNT_ALLOCATIONS
+
+// Plain thread_local data, so reading it from operator new needs no
+// initialization of its own.
+static thread_local uint64_t heapAllocations = 0;
+
+// Every form is replaced, nothrow and over-aligned (alignas above the
+// default) included, so no allocation escapes the count and every block is
+// freed by the allocator that made it.
+static void* allocate(size_t size) {
+    heapAllocations++;
+    return std::malloc(size ? size : 1);
+}
+
+static void* orThrow(void* p) {
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return orThrow(allocate(size)); }
+void* operator new[](size_t size) { return orThrow(allocate(size)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+// Over-aligned new only exists from C++17 (/std:c++17 on MSVC).
+#ifdef __cpp_aligned_new
+static void* allocateAligned(size_t size, std::align_val_t alignment) {
+    heapAllocations++;
+    size_t align = (size_t)alignment;
+    if (size == 0) size = 1;
+#ifdef _WIN32
+    return _aligned_malloc(size, align);
+#else
+    void* p = nullptr;
+    return posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, size) == 0 ? p : nullptr;
+#endif
+}
+
+static void freeAligned(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(size_t size, std::align_val_t alignment) { return orThrow(allocateAligned(size, alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return orThrow(allocateAligned(size, alignment)); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+#endif
+
+uint64_t threadHeapAllocations() {
+    return heapAllocations;
+}
+
+#else
+
+uint64_t threadHeapAllocations() {
+    return 0;
+}
+
+#endif
+
+void FrameHeapCheck::begin() {
+    start_ = threadHeapAllocations();
+}
+
+uint64_t FrameHeapCheck::end() {
+    uint64_t allocations = threadHeapAllocations() - start_;
+    frameArena().reset();
+    frames_++;
+    // Transient data belongs in the frame arena; whatever got here instead
+    // allocates again next frame.
+    assert((frames_ <= FRAME_ARENA_WARMUP_FRAMES || allocations == 0) && "steady-state frame allocated from the heap");
+    return allocations;
+}
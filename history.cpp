@@ -0,0 +1,247 @@
+#include "history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "lz.h"
+#include "profiler.h"
+
+// Per-fish columns, each stored as 16-bit fixed point. Positions and
+// velocities are signed; size and happiness are unsigned.
+enum HistoryColumn {
+    COL_X, COL_Y, COL_DX, COL_DY, COL_SIZE, COL_HAPPINESS, COL_FLAGS,
+    COL_COUNT
+};
+
+static const float POSITION_SCALE = 16000.0f;  // +-2.04 range
+static const float HAPPINESS_SCALE = 65535.0f;
+static const uint16_t FLAG_FACING_RIGHT = 1;
+static const uint16_t FLAG_DYING = 2;
+static const int FLAG_PHASE_SHIFT = 2;      // swim phase in bits 2-7
+static const int FLAG_SPECIES_SHIFT = 8;    // species in the high byte
+
+static uint16_t quantizeSigned(float v) {
+    float q = std::round(v * POSITION_SCALE);
+    if (q > 32767.0f) q = 32767.0f;
+    if (q < -32768.0f) q = -32768.0f;
+    return (uint16_t)(int16_t)q;
+}
+
+static float dequantizeSigned(uint16_t q) {
+    return (float)(int16_t)q / POSITION_SCALE;
+}
+
+TankHistory::TankHistory(size_t memoryBudget, int keyframeInterval)
+    : budget_(memoryBudget), keyframeInterval_(keyframeInterval > 0 ? keyframeInterval : 1) {
+}
+
+void TankHistory::clear() {
+    writePos_ = 0;
+    firstFrame_ = 0;
+    frameCount_ = 0;
+    groupCount_ = 0;
+    groupFrames_ = 0;
+    largestFishCount_ = 0;
+    prev_.clear();
+    bytes_ = 0;
+}
+
+uint64_t TankHistory::oldestTick() const {
+    return frameCount_ ? frameAt(0).tick : 0;
+}
+
+uint64_t TankHistory::newestTick() const {
+    return frameCount_ ? frameAt(frameCount_ - 1).tick : 0;
+}
+
+void TankHistory::quantize(const std::vector<Fish>& fish, std::vector<uint16_t>& q) const {
+    size_t n = fish.size();
+    q.resize(n * COL_COUNT);
+    uint16_t* x = &q[n * COL_X];
+    uint16_t* y = &q[n * COL_Y];
+    uint16_t* dx = &q[n * COL_DX];
+    uint16_t* dy = &q[n * COL_DY];
+    uint16_t* size = &q[n * COL_SIZE];
+    uint16_t* happiness = &q[n * COL_HAPPINESS];
+    uint16_t* flags = &q[n * COL_FLAGS];
+    for (size_t i = 0; i < n; i++) {
+        const Fish& f = fish[i];
+        x[i] = quantizeSigned(f.x);
+        y[i] = quantizeSigned(f.y);
+        dx[i] = quantizeSigned(f.dx);
+        dy[i] = quantizeSigned(f.dy);
+        size[i] = quantizeSigned(f.size);
+        happiness[i] = (uint16_t)std::lround(std::min(std::max(f.happiness, 0.0f), 1.0f) * HAPPINESS_SCALE);
+        flags[i] = (uint16_t)((f.facingRight ? FLAG_FACING_RIGHT : 0) | (f.isDying ? FLAG_DYING : 0) |
+            (f.swimPhase << FLAG_PHASE_SHIFT) | (f.species << FLAG_SPECIES_SHIFT));
+    }
+}
+
+void TankHistory::dequantize(const FrameVector<uint16_t>& q, uint32_t count, std::vector<Fish>& fish) {
+    size_t n = count;
+    fish.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        Fish& f = fish[i];
+        f.x = dequantizeSigned(q[n * COL_X + i]);
+        f.y = dequantizeSigned(q[n * COL_Y + i]);
+        f.dx = dequantizeSigned(q[n * COL_DX + i]);
+        f.dy = dequantizeSigned(q[n * COL_DY + i]);
+        f.size = dequantizeSigned(q[n * COL_SIZE + i]);
+        f.happiness = q[n * COL_HAPPINESS + i] / HAPPINESS_SCALE;
+        uint16_t flags = q[n * COL_FLAGS + i];
+        f.facingRight = (flags & FLAG_FACING_RIGHT) != 0;
+        f.isDying = (flags & FLAG_DYING) != 0;
+        f.swimPhase = (uint8_t)((flags >> FLAG_PHASE_SHIFT) & (FISH_SWIM_PHASES - 1));
+        f.species = (uint8_t)(flags >> FLAG_SPECIES_SHIFT);
+    }
+}
+
+// Delta against the previous tick, or against zero for a keyframe, then
+// split into low and high byte planes: slow-moving columns leave the high
+// plane almost entirely zero, which the LZ stage collapses.
+void TankHistory::encode(bool keyframe) {
+    size_t count = current_.size();
+    planes_.resize(count * 2);
+    for (size_t i = 0; i < count; i++) {
+        uint16_t d = keyframe ? current_[i] : (uint16_t)(current_[i] - prev_[i]);
+        planes_[i] = (uint8_t)(d & 0xFF);
+        planes_[count + i] = (uint8_t)(d >> 8);
+    }
+    compressScratch_.clear();
+    compressScratch_.reserve(lzCompressBound(planes_.size()));
+    lzCompress(planes_.data(), planes_.size(), compressScratch_);
+}
+
+// Where a frame of 'size' bytes fits in the ring without wrapping, or
+// SIZE_MAX. The held bytes run from the oldest frame up to writePos_; a
+// frame that does not fit before the end of the ring starts over at 0.
+size_t TankHistory::place(size_t size) const {
+    if (frameCount_ == frames_.size()) return SIZE_MAX;
+    if (frameCount_ == 0) return size <= budget_ ? 0 : SIZE_MAX;
+    size_t oldest = frameAt(0).offset;
+    if (writePos_ > oldest) {
+        if (writePos_ + size <= budget_) return writePos_;
+        return size < oldest ? 0 : SIZE_MAX;
+    }
+    return writePos_ + size < oldest ? writePos_ : SIZE_MAX;
+}
+
+// Drops groups until the frame fits. A delta needs the group being written,
+// so that one is only dropped for a keyframe.
+bool TankHistory::makeRoom(size_t size, bool keyframe, size_t& offset) {
+    for (;;) {
+        offset = place(size);
+        if (offset != SIZE_MAX) return true;
+        if (groupCount_ == 0 || (groupCount_ == 1 && !keyframe)) return false;
+        dropOldestGroup();
+    }
+}
+
+void TankHistory::dropOldestGroup() {
+    do {
+        bytes_ -= frameAt(0).size;
+        firstFrame_ = (firstFrame_ + 1) % frames_.size();
+        frameCount_--;
+    } while (frameCount_ > 0 && !frameAt(0).keyframe);
+    groupCount_--;
+    if (frameCount_ == 0) {
+        writePos_ = 0;
+        groupFrames_ = 0;
+    }
+}
+
+void TankHistory::record(uint64_t tick, float time, const std::vector<Fish>& fish, const SnapshotLevels& levels) {
+    PROFILE_SCOPE("History record");
+    if (!ring_) {
+        ring_.reset(new uint8_t[budget_]);
+        frames_.resize(HISTORY_MAX_TICKS);
+    }
+    if (frameCount_ > 0 && tick <= newestTick()) {
+        // Time went backwards (e.g. a snapshot reload); start over.
+        clear();
+    }
+
+    quantize(fish, current_);
+    bool keyframe = frameCount_ == 0 || groupFrames_ >= keyframeInterval_ || prev_.size() != current_.size();
+    encode(keyframe);
+
+    size_t offset;
+    if (!makeRoom(compressScratch_.size(), keyframe, offset)) {
+        // The group being written fills the ring on its own; start over
+        // from this tick.
+        clear();
+        keyframe = true;
+        encode(true);
+        if (!makeRoom(compressScratch_.size(), keyframe, offset)) {
+            std::cerr << "A tick of " << fish.size() << " fish does not fit the history budget\n";
+            return;
+        }
+    }
+
+    size_t size = compressScratch_.size();
+    std::memcpy(ring_.get() + offset, compressScratch_.data(), size);
+    writePos_ = offset + size;
+    bytes_ += size;
+
+    Frame& frame = frames_[(firstFrame_ + frameCount_) % frames_.size()];
+    frame.tick = tick;
+    frame.time = time;
+    frame.levels = levels;
+    frame.fishCount = (uint32_t)fish.size();
+    frame.keyframe = keyframe;
+    frame.offset = offset;
+    frame.size = size;
+    frameCount_++;
+    if (keyframe) {
+        groupCount_++;
+        groupFrames_ = 0;
+    }
+    groupFrames_++;
+    largestFishCount_ = std::max(largestFishCount_, frame.fishCount);
+    prev_.swap(current_);
+}
+
+bool TankHistory::decodeFrame(const Frame& frame, FrameVector<uint16_t>& q, FrameVector<uint8_t>& scratch) const {
+    size_t count = (size_t)frame.fishCount * COL_COUNT;
+    scratch.resize(count * 2);
+    if (!lzDecompress(ring_.get() + frame.offset, frame.size, scratch.data(), scratch.size())) {
+        return false;
+    }
+    q.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        uint16_t d = (uint16_t)(scratch[i] | (scratch[count + i] << 8));
+        q[i] = (uint16_t)(q[i] + d);
+    }
+    return true;
+}
+
+bool TankHistory::seek(uint64_t tick, std::vector<Fish>& fish, SnapshotLevels& levels, float* time) const {
+    PROFILE_SCOPE("History seek");
+    if (frameCount_ == 0 || tick < oldestTick()) return false;
+
+    // Last frame at or before 'tick', and the keyframe of its group.
+    size_t lo = 0, hi = frameCount_;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (frameAt(mid).tick <= tick) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t last = lo - 1;
+    size_t key = last;
+    while (!frameAt(key).keyframe) key--;
+
+    FrameVector<uint16_t> q((size_t)frameAt(key).fishCount * COL_COUNT, 0);
+    FrameVector<uint8_t> scratch;
+    for (size_t i = key; i <= last; i++) {
+        if (!decodeFrame(frameAt(i), q, scratch)) return false;
+    }
+    const Frame& target = frameAt(last);
+    // Room for any recorded tick, so scrubbing never grows it.
+    fish.reserve(largestFishCount_);
+    dequantize(q, target.fishCount, fish);
+    levels = target.levels;
+    if (time) *time = target.time;
+    return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "aquarium.h"
+#include "frame_arena.h"
+#include "snapshot.h"
+
+const int HISTORY_KEYFRAME_INTERVAL = 120;            // ticks between keyframes
+const size_t HISTORY_MEMORY_BUDGET = 64u * 1024 * 1024; // bytes of encoded history
+const size_t HISTORY_MAX_TICKS = 60 * 60 * 10;          // ticks indexed, 10 minutes at 60 Hz
+
+// Rewind buffer for the tank. Every recorded tick is quantized to 16-bit
+// columns, delta-encoded against the previous tick (keyframes against zero),
+// split into byte planes and LZ-compressed. Ticks are grouped behind their
+// keyframe. Seeking decodes one keyframe plus at most
+// HISTORY_KEYFRAME_INTERVAL - 1 deltas.
+//
+// The encoded ticks go to a byte ring of the memory budget and their headers
+// to a ring of HISTORY_MAX_TICKS, both allocated by the first record(); whole
+// groups are dropped oldest-first to make room, so recording stays off the
+// heap after that.
+class TankHistory {
+public:
+    explicit TankHistory(size_t memoryBudget = HISTORY_MEMORY_BUDGET, int keyframeInterval = HISTORY_KEYFRAME_INTERVAL);
+
+    void record(uint64_t tick, float time, const std::vector<Fish>& fish, const SnapshotLevels& levels);
+    // Reconstructs the recorded state at or just before 'tick'.
+    bool seek(uint64_t tick, std::vector<Fish>& fish, SnapshotLevels& levels, float* time = nullptr) const;
+    void clear();
+
+    bool empty() const { return frameCount_ == 0; }
+    uint64_t oldestTick() const;
+    uint64_t newestTick() const;
+    size_t memoryUsed() const { return bytes_ + frames_.size() * sizeof(Frame); }
+
+private:
+    struct Frame {
+        uint64_t tick;
+        float time;
+        SnapshotLevels levels;
+        uint32_t fishCount;
+        bool keyframe;
+        size_t offset; // compressed byte planes in ring_
+        size_t size;
+    };
+
+    const Frame& frameAt(size_t i) const { return frames_[(firstFrame_ + i) % frames_.size()]; }
+    void quantize(const std::vector<Fish>& fish, std::vector<uint16_t>& q) const;
+    static void dequantize(const FrameVector<uint16_t>& q, uint32_t count, std::vector<Fish>& fish);
+    void encode(bool keyframe);
+    size_t place(size_t size) const;
+    bool makeRoom(size_t size, bool keyframe, size_t& offset);
+    void dropOldestGroup();
+    bool decodeFrame(const Frame& frame, FrameVector<uint16_t>& q, FrameVector<uint8_t>& scratch) const;
+
+    size_t budget_;
+    int keyframeInterval_;
+    size_t bytes_ = 0;        // encoded bytes held in ring_
+    uint32_t largestFishCount_ = 0;
+
+    std::unique_ptr<uint8_t[]> ring_;
+    size_t writePos_ = 0;
+    std::vector<Frame> frames_;
+    size_t firstFrame_ = 0;
+    size_t frameCount_ = 0;
+    size_t groupCount_ = 0;
+    int groupFrames_ = 0;     // frames in the newest group
+
+    // Quantized columns of the last recorded tick, used as the delta base.
+    std::vector<uint16_t> prev_;
+    std::vector<uint16_t> current_;
+    std::vector<uint8_t> planes_;
+    // LZ output, copied into the ring.
+    std::vector<uint8_t> compressScratch_;
+};
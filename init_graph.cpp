@@ -0,0 +1,131 @@
+#include "init_graph.h"
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "profiler.h"
+
+InitGraph::InitGraph()
+    : start_(std::chrono::steady_clock::now()) {
+}
+
+int InitGraph::add(const char* name, InitThread thread, std::function<bool()> run, std::initializer_list<int> dependencies) {
+    Task task;
+    task.name = name;
+    task.thread = thread;
+    task.run = std::move(run);
+    for (int dependency : dependencies) {
+        assert(dependency >= 0 && dependency < (int)tasks_.size());
+        task.dependencies.push_back(dependency);
+    }
+    tasks_.push_back(std::move(task));
+    return (int)tasks_.size() - 1;
+}
+
+double InitGraph::elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+}
+
+void InitGraph::execute(int index) {
+    Task& task = tasks_[index];
+    if (task.thread == INIT_WORKER_THREAD) PROFILE_THREAD_NAME(task.name);
+    double startMs = elapsedMs();
+    bool ok;
+    {
+        PROFILE_SCOPE(task.name);
+        ok = task.run();
+    }
+    double endMs = elapsedMs();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    task.startMs = startMs;
+    task.endMs = endMs;
+    task.state = ok ? TASK_DONE : TASK_FAILED;
+    finished_.notify_all();
+}
+
+bool InitGraph::run() {
+    std::vector<std::thread> workers;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        // Settle what can be decided now: tasks whose dependencies failed are
+        // skipped, and every ready worker task is started before the main
+        // thread gets busy with one of its own.
+        int mainTask = -1;
+        int running = 0;
+        bool progressed = true;
+        while (progressed) {
+            progressed = false;
+            mainTask = -1;
+            running = 0;
+            for (size_t i = 0; i < tasks_.size(); i++) {
+                Task& task = tasks_[i];
+                if (task.state == TASK_RUNNING) running++;
+                if (task.state != TASK_WAITING) continue;
+                bool ready = true, blocked = false;
+                for (int dependency : task.dependencies) {
+                    TaskState state = tasks_[dependency].state;
+                    if (state == TASK_FAILED || state == TASK_SKIPPED) blocked = true;
+                    if (state != TASK_DONE) ready = false;
+                }
+                if (blocked) {
+                    task.state = TASK_SKIPPED;
+                    progressed = true;
+                }
+                else if (ready && task.thread == INIT_WORKER_THREAD) {
+                    task.state = TASK_RUNNING;
+                    running++;
+                    workers.emplace_back(&InitGraph::execute, this, (int)i);
+                }
+                else if (ready && mainTask < 0) {
+                    mainTask = (int)i;
+                }
+            }
+        }
+
+        if (mainTask >= 0) {
+            tasks_[mainTask].state = TASK_RUNNING;
+            lock.unlock();
+            execute(mainTask);
+            lock.lock();
+        }
+        else if (running > 0) {
+            finished_.wait(lock);
+        }
+        else {
+            break;
+        }
+    }
+    lock.unlock();
+    for (std::thread& worker : workers) worker.join();
+
+    bool ok = true;
+    for (const Task& task : tasks_) {
+        if (task.state == TASK_DONE) continue;
+        if (task.state == TASK_SKIPPED) std::cerr << "Startup: skipped " << task.name << "\n";
+        else std::cerr << "Startup: " << task.name << " failed\n";
+        ok = false;
+    }
+    return ok;
+}
+
+void InitGraph::mark(const char* name) {
+    marks_.push_back({ name, elapsedMs() });
+}
+
+void InitGraph::report(std::ostream& out) const {
+    out << "Startup (ms since launch):\n";
+    char line[128];
+    for (const Task& task : tasks_) {
+        if (task.state != TASK_DONE) continue;
+        snprintf(line, sizeof(line), "  %-24s %-6s %8.1f -> %8.1f  (%.1f)\n", task.name,
+            task.thread == INIT_WORKER_THREAD ? "worker" : "main", task.startMs, task.endMs, task.endMs - task.startMs);
+        out << line;
+    }
+    for (const Mark& mark : marks_) {
+        snprintf(line, sizeof(line), "  %-24s %-6s %8.1f\n", mark.name, "", mark.ms);
+        out << line;
+    }
+}
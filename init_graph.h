@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <initializer_list>
+#include <iosfwd>
+#include <mutex>
+#include <vector>
+
+enum InitThread {
+    INIT_MAIN_THREAD,   // touches GL or the window: runs on the calling thread
+    INIT_WORKER_THREAD, // CPU-only: runs on a thread of its own
+};
+
+// Startup as a graph of named tasks. Each task starts as soon as the tasks
+// it depends on have finished: worker tasks on their own threads, main
+// tasks one at a time on the thread that called run(), so file loading and
+// decoding overlap with creating the window and GL context. Every task is
+// timed from the graph's construction, which main() does first, and shows
+// up as a profiler zone.
+class InitGraph {
+public:
+    InitGraph();
+
+    // Dependencies must have been added before; returns the task's id.
+    int add(const char* name, InitThread thread, std::function<bool()> run, std::initializer_list<int> dependencies = {});
+    // Runs every task and waits for all of them. A task returning false
+    // fails, and the tasks depending on it are skipped. Returns false if
+    // any task failed.
+    bool run();
+
+    // Records a named moment, such as the first frame presented.
+    void mark(const char* name);
+    // Prints every task and mark in milliseconds since construction.
+    void report(std::ostream& out) const;
+
+private:
+    enum TaskState { TASK_WAITING, TASK_RUNNING, TASK_DONE, TASK_FAILED, TASK_SKIPPED };
+    struct Task {
+        const char* name;
+        InitThread thread;
+        std::function<bool()> run;
+        std::vector<int> dependencies;
+        TaskState state = TASK_WAITING;
+        double startMs = 0.0, endMs = 0.0;
+    };
+    struct Mark {
+        const char* name;
+        double ms;
+    };
+
+    double elapsedMs() const;
+    void execute(int task);
+
+    std::chrono::steady_clock::time_point start_;
+    std::vector<Task> tasks_;
+    std::vector<Mark> marks_;
+    std::mutex mutex_;
+    std::condition_variable finished_;  // run(): a worker task finished
+};
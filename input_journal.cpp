@@ -0,0 +1,196 @@
+#include "input_journal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "mapped_file.h"
+#include "telemetry.h"
+
+static const uint32_t JOURNAL_MAGIC = 0x4A495141; // "AQIJ"
+static const uint16_t JOURNAL_VERSION = 1;
+
+struct JournalHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t seed;
+    float fixedDt;
+    uint64_t snapshotSize;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(JournalHeader) == 32, "JournalHeader must stay 32 bytes");
+
+static void writeVarint(std::ofstream& file, uint64_t v) {
+    while (v >= 0x80) {
+        char b = (char)(v | 0x80);
+        file.put(b);
+        v >>= 7;
+    }
+    file.put((char)v);
+}
+
+static bool readVarint(const unsigned char*& p, const unsigned char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end) return false;
+        unsigned char b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// InputJournalWriter
+
+bool InputJournalWriter::open(const char* path, uint32_t seed, float fixedDt, const std::vector<Fish>& fish, const SnapshotLevels& levels) {
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        std::cerr << "Failed to open journal " << path << " for writing\n";
+        return false;
+    }
+    SnapshotHeader snapshot = makeSnapshotHeader(fish.data(), fish.size(), levels);
+
+    JournalHeader header = {};
+    header.magic = JOURNAL_MAGIC;
+    header.version = JOURNAL_VERSION;
+    header.headerSize = sizeof(JournalHeader);
+    header.seed = seed;
+    header.fixedDt = fixedDt;
+    header.snapshotSize = sizeof(SnapshotHeader) + fish.size() * sizeof(Fish);
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_.write(reinterpret_cast<const char*>(&snapshot), sizeof(snapshot));
+    file_.write(reinterpret_cast<const char*>(fish.data()), (std::streamsize)(fish.size() * sizeof(Fish)));
+
+    startTick_ = simulationTick;
+    lastTick_ = 0;
+    return (bool)file_;
+}
+
+void InputJournalWriter::writeEvent(InputEventType type, uint64_t tick) {
+    file_.put((char)type);
+    writeVarint(file_, tick - lastTick_);
+    lastTick_ = tick;
+}
+
+void InputJournalWriter::record(InputEventType type, float x, float y) {
+    if (!isOpen()) return;
+    writeEvent(type, simulationTick - startTick_);
+    file_.write(reinterpret_cast<const char*>(&x), sizeof(float));
+    file_.write(reinterpret_cast<const char*>(&y), sizeof(float));
+}
+
+void InputJournalWriter::close() {
+    if (!isOpen()) return;
+    writeEvent(INPUT_EVENT_END, simulationTick - startTick_);
+    file_.close();
+}
+
+// InputJournalReader
+
+bool InputJournalReader::open(const char* path, std::vector<Fish>& fish, SnapshotLevels& levels) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to open journal " << path << "\n";
+        return false;
+    }
+    JournalHeader header;
+    if (file.size() < sizeof(header)) return false;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != JOURNAL_MAGIC || header.version != JOURNAL_VERSION || header.headerSize != sizeof(JournalHeader) ||
+        header.snapshotSize > file.size() - sizeof(header)) {
+        std::cerr << "Journal " << path << " is not a supported input journal\n";
+        return false;
+    }
+    if (!loadSnapshotFromMemory(file.data() + sizeof(header), (size_t)header.snapshotSize, path, fish, levels)) {
+        return false;
+    }
+    seed_ = header.seed;
+    fixedDt_ = header.fixedDt;
+
+    events_.clear();
+    next_ = 0;
+    const unsigned char* p = file.data() + sizeof(header) + header.snapshotSize;
+    const unsigned char* end = file.data() + file.size();
+    uint64_t tick = 0;
+    bool ended = false;
+    while (p < end && !ended) {
+        InputEvent event = {};
+        event.type = (InputEventType)*p++;
+        uint64_t delta;
+        if (!readVarint(p, end, delta)) break;
+        tick += delta;
+        event.tick = tick;
+        if (event.type == INPUT_EVENT_CLICK) {
+            if (end - p < 8) break;
+            std::memcpy(&event.x, p, 4);
+            std::memcpy(&event.y, p + 4, 4);
+            p += 8;
+            events_.push_back(event);
+        }
+        else if (event.type == INPUT_EVENT_END) {
+            ended = true;
+        }
+        else {
+            break;
+        }
+    }
+    if (!ended) {
+        // A session that crashed still replays up to its last event.
+        std::cerr << "Journal " << path << " has no end marker, replaying what was recorded\n";
+    }
+    endTick_ = tick;
+    return true;
+}
+
+void InputJournalReader::applyEvents(uint64_t tick) {
+    while (next_ < events_.size() && events_[next_].tick <= tick) {
+        const InputEvent& event = events_[next_++];
+        if (event.type == INPUT_EVENT_CLICK) applyClick(event.x, event.y);
+    }
+}
+
+// Replay Reports
+
+void printFrameTimeSummary(const char* label, std::vector<float>& frameTimes) {
+    if (frameTimes.empty()) return;
+    std::sort(frameTimes.begin(), frameTimes.end());
+    double sum = 0.0;
+    for (float t : frameTimes) sum += t;
+    size_t n = frameTimes.size();
+    std::cout << label << ": " << n << " frames"
+        << "  avg " << sum / n * 1000.0 << " ms"
+        << "  p50 " << frameTimes[n / 2] * 1000.0 << " ms"
+        << "  p99 " << frameTimes[std::min(n - 1, n * 99 / 100)] * 1000.0 << " ms"
+        << "  max " << frameTimes.back() * 1000.0 << " ms\n";
+}
+
+int runHeadlessReplay(const char* path) {
+    InputJournalReader journal;
+    SnapshotLevels levels;
+    if (!journal.open(path, fishes, levels)) return -1;
+    oxygenLevel = levels.oxygen;
+    foodLevel = levels.food;
+    areFishesDying = levels.fishesDying;
+    simulationTick = 0;
+    srand(journal.seed());
+
+    FishStats stats;
+    std::vector<float> stepTimes;
+    stepTimes.reserve((size_t)journal.endTick());
+    while (!journal.finished(simulationTick)) {
+        auto start = std::chrono::steady_clock::now();
+        journal.applyEvents(simulationTick);
+        stepSimulation(journal.fixedDt(), stats);
+        stepTimes.push_back(std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    printFrameTimeSummary("Headless replay steps", stepTimes);
+    std::cout << "Final tick " << simulationTick
+        << "  oxygen " << oxygenLevel << "  food " << foodLevel
+        << "  fish checksum " << std::hex << snapshotChecksum(fishes.data(), fishes.size() * sizeof(Fish)) << std::dec << "\n";
+    return 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "aquarium.h"
+#include "snapshot.h"
+
+const float JOURNAL_FIXED_DT = 1.0f / 60.0f;
+const int JOURNAL_MAX_STEPS_PER_FRAME = 8;
+
+enum InputEventType : uint8_t {
+    INPUT_EVENT_END = 0,   // marks the last recorded tick
+    INPUT_EVENT_CLICK = 1, // normalized click position, fed to applyClick
+};
+
+struct InputEvent {
+    uint64_t tick; // simulation steps since the journal started
+    InputEventType type;
+    float x, y;
+};
+
+// Input journal layout (host byte order, like the snapshot it embeds):
+//   JournalHeader, then the starting tank as an embedded snapshot of
+//   snapshotSize bytes, then the events: u8 type, varint tick delta, and for
+//   clicks two f32 coordinates. An END event carries the final tick.
+//
+// Events are stamped with the number of simulation steps completed when they
+// arrived and are applied before the next step, both live and in replay, so
+// a replay with the same seed and timestep reproduces the session exactly.
+class InputJournalWriter {
+public:
+    bool open(const char* path, uint32_t seed, float fixedDt, const std::vector<Fish>& fish, const SnapshotLevels& levels);
+    void record(InputEventType type, float x, float y);
+    void close();
+    bool isOpen() const { return file_.is_open(); }
+
+private:
+    void writeEvent(InputEventType type, uint64_t tick);
+
+    std::ofstream file_;
+    uint64_t startTick_ = 0;
+    uint64_t lastTick_ = 0;
+};
+
+class InputJournalReader {
+public:
+    // Loads the journal and the starting tank it embeds.
+    bool open(const char* path, std::vector<Fish>& fish, SnapshotLevels& levels);
+
+    uint32_t seed() const { return seed_; }
+    float fixedDt() const { return fixedDt_; }
+    uint64_t endTick() const { return endTick_; }
+    bool finished(uint64_t tick) const { return tick >= endTick_; }
+
+    // Applies every event stamped with 'tick'.
+    void applyEvents(uint64_t tick);
+
+private:
+    std::vector<InputEvent> events_;
+    size_t next_ = 0;
+    uint32_t seed_ = 0;
+    float fixedDt_ = JOURNAL_FIXED_DT;
+    uint64_t endTick_ = 0;
+};
+
+// Replays a journal without a window as fast as possible and reports the
+// step timings and a checksum of the final tank. Returns the process exit code.
+int runHeadlessReplay(const char* path);
+
+// Prints avg/p50/p99/max of the given frame times (seconds). Sorts the input.
+void printFrameTimeSummary(const char* label, std::vector<float>& frameTimes);
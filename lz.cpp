@@ -0,0 +1,113 @@
+#include "lz.h"
+
+#include <cstring>
+
+static const int LZ_MIN_MATCH = 4;
+static const int LZ_HASH_BITS = 12;
+static const size_t LZ_MAX_OFFSET = 65535;
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+static uint32_t hash32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void writeLength(std::vector<uint8_t>& out, size_t len) {
+    while (len >= 255) {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back((uint8_t)len);
+}
+
+static void emitSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t litLen, size_t offset, size_t matchLen) {
+    size_t matchCode = matchLen ? matchLen - LZ_MIN_MATCH : 0;
+    uint8_t token = (uint8_t)(((litLen < 15 ? litLen : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    out.push_back(token);
+    if (litLen >= 15) writeLength(out, litLen - 15);
+    out.insert(out.end(), literals, literals + litLen);
+    if (matchLen) {
+        out.push_back((uint8_t)(offset & 0xFF));
+        out.push_back((uint8_t)(offset >> 8));
+        if (matchCode >= 15) writeLength(out, matchCode - 15);
+    }
+}
+
+size_t lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+    size_t start = out.size();
+    int32_t table[1 << LZ_HASH_BITS];
+    for (int32_t& t : table) t = -1;
+
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + LZ_MIN_MATCH <= size) {
+        uint32_t seq = read32(src + i);
+        uint32_t h = hash32(seq);
+        int32_t ref = table[h];
+        table[h] = (int32_t)i;
+
+        if (ref >= 0 && i - (size_t)ref <= LZ_MAX_OFFSET && read32(src + ref) == seq) {
+            size_t len = LZ_MIN_MATCH;
+            while (i + len < size && src[ref + len] == src[i + len]) len++;
+            emitSequence(out, src + anchor, i - anchor, i - (size_t)ref, len);
+            i += len;
+            anchor = i;
+        }
+        else {
+            i++;
+        }
+    }
+    // Trailing literals form a final sequence without a match.
+    emitSequence(out, src + anchor, size - anchor, 0, 0);
+    return out.size() - start;
+}
+
+size_t lzCompressBound(size_t size) {
+    // All literals: one token plus a length byte per 255 of them.
+    return size + size / 255 + 16;
+}
+
+static bool readLength(const uint8_t*& ip, const uint8_t* end, size_t& len) {
+    uint8_t b;
+    do {
+        if (ip >= end) return false;
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+bool lzDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize) {
+    const uint8_t* ip = src;
+    const uint8_t* end = src + size;
+    size_t op = 0;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t litLen = token >> 4;
+        if (litLen == 15 && !readLength(ip, end, litLen)) return false;
+        if ((size_t)(end - ip) < litLen || dstSize - op < litLen) return false;
+        std::memcpy(dst + op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+        if (ip == end) break;
+
+        if (end - ip < 2) return false;
+        size_t offset = ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t matchLen = token & 15;
+        if (matchLen == 15 && !readLength(ip, end, matchLen)) return false;
+        matchLen += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || dstSize - op < matchLen) return false;
+
+        // Byte copy so overlapping matches repeat correctly.
+        const uint8_t* from = dst + op - offset;
+        for (size_t k = 0; k < matchLen; k++) dst[op + k] = from[k];
+        op += matchLen;
+    }
+    return op == dstSize;
+}
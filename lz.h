@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Small LZ77 block codec in the style of LZ4: greedy matching over a 4-byte
+// hash, 16-bit offsets and run-length encoded lengths. Meant for buffers
+// that are mostly zeros or repeats, such as XOR/delta encoded frames.
+
+// Appends the compressed form of src to out and returns the compressed size.
+size_t lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out);
+
+// Most bytes lzCompress can append for 'size' input bytes.
+size_t lzCompressBound(size_t size);
+
+// Decompresses exactly dstSize bytes into dst. Returns false on malformed input.
+bool lzDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize);
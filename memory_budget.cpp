@@ -0,0 +1,81 @@
+#include "memory_budget.h"
+
+#include <atomic>
+#include <cstdio>
+#include <ostream>
+
+static std::atomic<size_t> currentBytes[MEMORY_CATEGORY_COUNT];
+static std::atomic<size_t> peakBytes[MEMORY_CATEGORY_COUNT];
+static std::atomic<size_t> budgetBytes[MEMORY_CATEGORY_COUNT];
+
+static const char* const MEMORY_CATEGORY_NAMES[MEMORY_CATEGORY_COUNT] = {
+    "GPU textures",
+    "GPU buffers",
+    "Fish",
+    "History",
+    "Frame arenas",
+    "Decode scratch",
+};
+
+static void raisePeak(MemoryCategory category, size_t bytes) {
+    size_t peak = peakBytes[category].load(std::memory_order_relaxed);
+    while (bytes > peak && !peakBytes[category].compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {
+    }
+}
+
+void memoryAllocated(MemoryCategory category, size_t bytes) {
+    raisePeak(category, currentBytes[category].fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+void memoryFreed(MemoryCategory category, size_t bytes) {
+    currentBytes[category].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void memorySet(MemoryCategory category, size_t bytes) {
+    currentBytes[category].store(bytes, std::memory_order_relaxed);
+    raisePeak(category, bytes);
+}
+
+MemoryUsage memoryUsage(MemoryCategory category) {
+    MemoryUsage usage;
+    usage.current = currentBytes[category].load(std::memory_order_relaxed);
+    usage.peak = peakBytes[category].load(std::memory_order_relaxed);
+    usage.budget = budgetBytes[category].load(std::memory_order_relaxed);
+    return usage;
+}
+
+const char* memoryCategoryName(MemoryCategory category) {
+    return MEMORY_CATEGORY_NAMES[category];
+}
+
+void printMemoryReport(std::ostream& out) {
+    out << "Memory (MB, current / peak / budget):\n";
+    for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+        MemoryUsage usage = memoryUsage((MemoryCategory)i);
+        char line[128];
+        snprintf(line, sizeof(line), "  %-15s %8.2f %8.2f", MEMORY_CATEGORY_NAMES[i],
+            usage.current / (1024.0 * 1024.0), usage.peak / (1024.0 * 1024.0));
+        out << line;
+        if (usage.budget) {
+            snprintf(line, sizeof(line), " %8.2f%s", usage.budget / (1024.0 * 1024.0),
+                usage.peak > usage.budget ? "  over budget" : "");
+            out << line;
+        }
+        out << "\n";
+    }
+}
+
+void setMemoryBudget(MemoryCategory category, size_t bytes) {
+    budgetBytes[category].store(bytes, std::memory_order_relaxed);
+}
+
+int textureReduction(size_t fullBytes, int maxReduction, size_t reservedBytes) {
+    MemoryUsage textures = memoryUsage(MEMORY_GPU_TEXTURES);
+    if (textures.budget == 0) return 0;
+    size_t committed = textures.current + reservedBytes;
+    size_t room = committed < textures.budget ? textures.budget - committed : 0;
+    // Every halving of the sides quarters the bytes.
+    int reduction = 0;
+    while (reduction < maxReduction && (fullBytes >> (2 * reduction)) > room) reduction++;
+    return reduction;
+}
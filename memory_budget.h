@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+
+// What memory is spent on. The GPU categories count the storage the
+// program asked for, not the driver's own copies or padding.
+enum MemoryCategory {
+    MEMORY_GPU_TEXTURES,    // textures and render targets
+    MEMORY_GPU_BUFFERS,     // vertex, uniform and readback buffers
+    MEMORY_FISH,            // the live tank's fish array
+    MEMORY_HISTORY,         // the rewind history and the tank it shows
+    MEMORY_FRAME_ARENAS,    // per-frame data of every thread: text vertices, draw lists
+    MEMORY_DECODE_SCRATCH,  // images while they are decoded, resampled or uploaded
+    MEMORY_CATEGORY_COUNT,
+};
+
+struct MemoryUsage {
+    size_t current;
+    size_t peak;
+    size_t budget;  // 0 for none
+};
+
+// The counters are atomic, so loader and worker threads report their own.
+void memoryAllocated(MemoryCategory category, size_t bytes);
+void memoryFreed(MemoryCategory category, size_t bytes);
+// For categories that are measured now and then rather than counted.
+void memorySet(MemoryCategory category, size_t bytes);
+
+MemoryUsage memoryUsage(MemoryCategory category);
+const char* memoryCategoryName(MemoryCategory category);
+// One line per category: current, peak and budget.
+void printMemoryReport(std::ostream& out);
+
+// Budgets are enforced where the memory is committed, for the categories
+// that can give way: textures are uploaded at lower resolution
+// (textureReduction) and the tank is cut down when it is loaded
+// (applyFishBudget). Budgets on the other categories are only reported.
+void setMemoryBudget(MemoryCategory category, size_t bytes);
+
+// Halvings of each side that a texture taking `fullBytes` at full size needs
+// to fit in what is left of the texture budget, with `reservedBytes` kept
+// back for textures that are still to come, capped at `maxReduction`.
+// 0 without a budget.
+int textureReduction(size_t fullBytes, int maxReduction, size_t reservedBytes = 0);
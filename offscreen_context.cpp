@@ -0,0 +1,158 @@
+#include "offscreen_context.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "gl_extensions.h"
+#include "memory_budget.h"
+
+#ifdef _WIN32
+#include <GLFW/glfw3.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// OffscreenContext
+
+#ifdef _WIN32
+
+bool OffscreenContext::create() {
+    if (!glfwInit()) {
+        std::cerr << "Failed to init GLFW\n";
+        return false;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_COMPAT_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "aquarium offscreen", nullptr, nullptr);
+    if (!window) {
+        std::cerr << "Failed to create hidden GLFW window\n";
+        glfwTerminate();
+        return false;
+    }
+    display_ = window;
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Failed to init GLAD\n";
+        destroy();
+        return false;
+    }
+    loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+    return true;
+}
+
+void OffscreenContext::destroy() {
+    if (!display_) return;
+    glfwDestroyWindow((GLFWwindow*)display_);
+    glfwTerminate();
+    display_ = nullptr;
+}
+
+#else
+
+bool OffscreenContext::create() {
+    // Prefer the surfaceless platform so no X or Wayland server is needed.
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cerr << "Failed to initialize EGL (error 0x" << std::hex << eglGetError() << std::dec << ")\n";
+        return false;
+    }
+    display_ = display;
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL does not support desktop OpenGL\n";
+        destroy();
+        return false;
+    }
+
+    // Nothing is ever drawn to an EGL surface, so no config is needed;
+    // fall back to choosing one for drivers without EGL_KHR_no_config_context.
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_no_config_context")) {
+        const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLint configCount = 0;
+        eglChooseConfig(display, configAttribs, &config, 1, &configCount);
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE,
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create an OpenGL 3.3 context (error 0x" << std::hex << eglGetError() << std::dec << ")\n";
+        destroy();
+        return false;
+    }
+    context_ = context;
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cerr << "Failed to make the offscreen context current\n";
+        destroy();
+        return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cerr << "Failed to init GLAD\n";
+        destroy();
+        return false;
+    }
+    loadGLExtensions((GLADloadproc)eglGetProcAddress);
+    return true;
+}
+
+void OffscreenContext::destroy() {
+    if (!display_) return;
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context_) eglDestroyContext(display_, context_);
+    eglTerminate(display_);
+    context_ = nullptr;
+    display_ = nullptr;
+}
+
+#endif
+
+// RenderTarget
+
+bool RenderTarget::create(int width, int height) {
+    width_ = width;
+    height_ = height;
+    glGenFramebuffers(1, &fbo_);
+    glGenRenderbuffers(1, &color_);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    memoryAllocated(MEMORY_GPU_TEXTURES, (size_t)width * height * 4);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer incomplete (0x" << std::hex << status << std::dec << ")\n";
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void RenderTarget::destroy() {
+    if (color_) memoryFreed(MEMORY_GPU_TEXTURES, (size_t)width_ * height_ * 4);
+    glDeleteFramebuffers(1, &fbo_);
+    glDeleteRenderbuffers(1, &color_);
+    fbo_ = 0;
+    color_ = 0;
+}
+
+void RenderTarget::bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glViewport(0, 0, width_, height_);
+}
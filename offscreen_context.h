@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// An OpenGL 3.3 compatibility context without a window, for rendering into
+// framebuffer objects on machines with no display. On Linux it uses EGL's
+// surfaceless platform, which Mesa serves with llvmpipe when there is no GPU;
+// Windows has no EGL, so a hidden GLFW window provides the context there.
+class OffscreenContext {
+public:
+    ~OffscreenContext() { destroy(); }
+
+    // Creates the context, makes it current and loads the GL entry points.
+    bool create();
+    void destroy();
+
+private:
+    void* display_ = nullptr;   // EGLDisplay, or the hidden GLFWwindow on Windows
+    void* context_ = nullptr;   // EGLContext
+};
+
+// A color renderbuffer attached to a framebuffer object, used in place of the
+// window's back buffer.
+class RenderTarget {
+public:
+    bool create(int width, int height);
+    void destroy();
+
+    // Binds the framebuffer and sets the viewport to cover it.
+    void bind();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    GLuint framebuffer() const { return fbo_; }
+
+private:
+    GLuint fbo_ = 0;
+    GLuint color_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+};
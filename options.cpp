@@ -0,0 +1,131 @@
+#include "options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+        << "  --record <journal>   record input into a journal while playing\n"
+        << "  --replay <journal>   replay a recorded journal with a fixed timestep\n"
+        << "  --headless           with --replay, run without a window\n"
+        << "  --trace <file>       write a Chrome trace of profiler zones on exit\n"
+        << "  --bench-frames <n>   render n frames offscreen, print frame times and exit\n"
+        << "  --bench-fish <k>     fish in the offscreen benchmark tank (default " << FRAME_BENCH_DEFAULT_FISH << ")\n"
+        << "  --bench-size <WxH>   benchmark resolution (default " << WINDOW_WIDTH << "x" << WINDOW_HEIGHT << ")\n"
+        << "  --export <file>      render a .y4m video or .png sequence offscreen and exit\n"
+        << "                       (of the --replay journal if given, else the saved tank)\n"
+        << "  --export-size <WxH>  export resolution (default " << WINDOW_WIDTH << "x" << WINDOW_HEIGHT << ")\n"
+        << "  --export-fps <n>     export frame rate (default 60)\n"
+        << "  --export-seconds <s> export length (default: the journal, or 10 s)\n"
+        << "  --software           render on the CPU; used anyway when OpenGL 3.3 is missing\n"
+        << "  --pack <file>        build an asset pack from the source assets and exit\n"
+        << "  --texture-budget <MB> upload textures smaller to keep GPU texture memory under MB\n"
+        << "  --fish-budget <MB>   leave fish out of tanks whose fish take more than MB;\n"
+        << "                       they are set aside unchanged and saved with the tank\n";
+}
+
+static bool parseMegabytes(const char* option, const char* value, size_t& bytes) {
+    double megabytes = std::atof(value);
+    if (megabytes <= 0.0) {
+        std::cerr << option << " expects a positive size in MB\n";
+        return false;
+    }
+    bytes = (size_t)(megabytes * 1024.0 * 1024.0);
+    return true;
+}
+
+bool parseOptions(int argc, char** argv, AppOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--record") == 0 && hasValue) {
+            options.recordPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--replay") == 0 && hasValue) {
+            options.replayPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--trace") == 0 && hasValue) {
+            options.tracePath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--bench-frames") == 0 && hasValue) {
+            options.benchFrames = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--bench-fish") == 0 && hasValue) {
+            options.benchFish = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--bench-size") == 0 && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.benchWidth, &options.benchHeight) != 2) {
+                std::cerr << "--bench-size expects <width>x<height>\n";
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--export") == 0 && hasValue) {
+            options.exportPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--export-size") == 0 && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.exportWidth, &options.exportHeight) != 2) {
+                std::cerr << "--export-size expects <width>x<height>\n";
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--export-fps") == 0 && hasValue) {
+            options.exportFps = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--export-seconds") == 0 && hasValue) {
+            options.exportSeconds = (float)std::atof(argv[++i]);
+        }
+        else if (std::strcmp(arg, "--pack") == 0 && hasValue) {
+            options.packPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--texture-budget") == 0 && hasValue) {
+            if (!parseMegabytes(arg, argv[++i], options.textureBudget)) return false;
+        }
+        else if (std::strcmp(arg, "--fish-budget") == 0 && hasValue) {
+            if (!parseMegabytes(arg, argv[++i], options.fishBudget)) return false;
+        }
+        else if (std::strcmp(arg, "--headless") == 0) {
+            options.headless = true;
+        }
+        else if (std::strcmp(arg, "--software") == 0) {
+            options.software = true;
+        }
+        else {
+            std::cerr << "Unknown or incomplete option: " << arg << "\n";
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (!options.recordPath.empty() && !options.replayPath.empty()) {
+        std::cerr << "--record and --replay cannot be combined\n";
+        return false;
+    }
+    if (options.benchFrames < 0 || options.benchFish < 0) {
+        std::cerr << "--bench-frames and --bench-fish must not be negative\n";
+        return false;
+    }
+    if (options.benchWidth <= 0 || options.benchHeight <= 0) {
+        std::cerr << "--bench-size must be positive\n";
+        return false;
+    }
+    if (options.benchFrames > 0 && (options.headless || !options.recordPath.empty() || !options.replayPath.empty())) {
+        std::cerr << "--bench-frames cannot be combined with --record, --replay or --headless\n";
+        return false;
+    }
+    if (!options.exportPath.empty()) {
+        if (options.exportWidth <= 0 || options.exportHeight <= 0 || options.exportFps <= 0) {
+            std::cerr << "--export-size and --export-fps must be positive\n";
+            return false;
+        }
+        if (options.headless || !options.recordPath.empty() || options.benchFrames > 0) {
+            std::cerr << "--export cannot be combined with --record, --headless or --bench-frames\n";
+            return false;
+        }
+    }
+    if (options.headless && options.replayPath.empty()) {
+        std::cerr << "--headless requires --replay\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include "aquarium.h"
+#include "frame_bench.h"
+
+// Command line options.
+//   --record <journal>   record input into a journal while playing
+//   --replay <journal>   replay a journal with a fixed timestep
+//   --headless           with --replay: run the simulation only, no window
+//   --trace <file>       write a Chrome trace of the profiler zones on exit
+//   --bench-frames <n>   render n frames offscreen, print frame times and exit
+//   --bench-fish <k>     fish in the offscreen benchmark tank
+//   --bench-size <WxH>   resolution of the offscreen benchmark
+//   --export <file>      render offscreen to a .y4m video or .png sequence and exit;
+//                        with --replay, exports the journal instead of the saved tank
+//   --export-size <WxH>, --export-fps <n>, --export-seconds <s>
+//   --software           draw on the CPU even if OpenGL 3.3 is available
+//   --pack <file>        build an asset pack from the source assets and exit
+//   --texture-budget <MB> GPU texture memory to fit in, by uploading scalable textures smaller
+//   --fish-budget <MB>   fish array size to fit in, by leaving fish out of a larger tank;
+//                        such a session is not saved, so the saved tank keeps them
+struct AppOptions {
+    std::string recordPath;
+    std::string replayPath;
+    bool headless = false;
+    std::string tracePath;
+    int benchFrames = 0;
+    int benchFish = FRAME_BENCH_DEFAULT_FISH;
+    int benchWidth = WINDOW_WIDTH;
+    int benchHeight = WINDOW_HEIGHT;
+    std::string exportPath;
+    int exportWidth = WINDOW_WIDTH;
+    int exportHeight = WINDOW_HEIGHT;
+    int exportFps = 60;
+    float exportSeconds = 0.0f;     // 0: the journal's length, or a default
+    bool software = false;
+    std::string packPath;
+    size_t textureBudget = 0;       // bytes; 0 for none
+    size_t fishBudget = 0;          // bytes; 0 for none
+};
+
+// Prints usage and returns false on unknown or incomplete arguments.
+bool parseOptions(int argc, char** argv, AppOptions& options);
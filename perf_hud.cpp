@@ -0,0 +1,173 @@
+#include "perf_hud.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "aquarium.h"
+#include "gpu_timer.h"
+#include "memory_budget.h"
+#include "stream_buffer.h"
+#include "stb_easy_font.h"
+
+int perfDrawCalls = 0;
+int perfStateChanges = 0;
+
+static const int PERF_VERTEX_SIZE = 16;                 // matches stb_easy_font output
+static const size_t PERF_VERTEX_CAPACITY = 64 * 1024;   // bytes of CPU staging, reserved once
+static const float PERF_HUD_X = WINDOW_WIDTH - 330.0f;
+static const float PERF_HUD_Y = 10.0f;
+static const float PERF_GRAPH_HEIGHT = 50.0f;
+static const float PERF_GRAPH_MAX_MS = 33.3f;
+
+static const char* perfVertexShaderSrc = R"glsl(
+#version 330 core
+layout(location=0) in vec2 aPos;
+layout(location=1) in vec4 aColor;
+uniform mat4 projection;
+out vec4 vColor;
+void main() {
+    gl_Position = projection * vec4(aPos, 0.0, 1.0);
+    vColor = aColor;
+}
+)glsl";
+
+static const char* perfFragmentShaderSrc = R"glsl(
+#version 330 core
+in vec4 vColor;
+out vec4 FragColor;
+void main() {
+    FragColor = vColor;
+}
+)glsl";
+
+void PerfHud::init() {
+    program_ = createShaderProgram(perfVertexShaderSrc, perfFragmentShaderSrc);
+    projectionLoc_ = glGetUniformLocation(program_, "projection");
+
+    vertices_.resize(PERF_VERTEX_CAPACITY);
+    glGenVertexArrays(1, &vao_);
+    bindStreamBuffer();
+}
+
+void PerfHud::bindStreamBuffer() {
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, streamBuffer.buffer());
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, PERF_VERTEX_SIZE, (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, PERF_VERTEX_SIZE, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    streamGeneration_ = streamBuffer.generation();
+}
+
+void PerfHud::shutdown() {
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteProgram(program_);
+}
+
+void PerfHud::addFrame(const PerfFrame& frame) {
+    frameTimes_[head_] = frame.frameMs;
+    head_ = (head_ + 1) % PERF_HUD_HISTORY;
+    if (count_ < PERF_HUD_HISTORY) count_++;
+    last_ = frame;
+}
+
+void PerfHud::addText(float x, float y, const char* text, const unsigned char color[4]) {
+    unsigned char c[4] = { color[0], color[1], color[2], color[3] };
+    int quads = stb_easy_font_print(x, y, const_cast<char*>(text), c,
+        vertices_.data() + used_, (int)(vertices_.size() - used_));
+    used_ += (size_t)quads * 4 * PERF_VERTEX_SIZE;
+}
+
+void PerfHud::addQuad(float x, float y, float w, float h, const unsigned char color[4]) {
+    if (used_ + 4 * PERF_VERTEX_SIZE > vertices_.size()) return;
+    const float corners[4][2] = { { x, y }, { x + w, y }, { x + w, y + h }, { x, y + h } };
+    for (const auto& corner : corners) {
+        char* v = vertices_.data() + used_;
+        float xyz[3] = { corner[0], corner[1], 0.0f };
+        std::memcpy(v, xyz, sizeof(xyz));
+        std::memcpy(v + 12, color, 4);
+        used_ += PERF_VERTEX_SIZE;
+    }
+}
+
+void PerfHud::render(const GpuTimer& gpu) {
+    if (!visible_ || count_ == 0) return;
+
+    static const unsigned char panel[4] = { 0, 0, 0, 170 };
+    static const unsigned char white[4] = { 255, 255, 255, 255 };
+    static const unsigned char grey[4] = { 180, 180, 180, 255 };
+    static const unsigned char good[4] = { 60, 220, 90, 255 };
+    static const unsigned char slow[4] = { 240, 200, 40, 255 };
+    static const unsigned char bad[4] = { 240, 60, 50, 255 };
+
+    float sorted[PERF_HUD_HISTORY];
+    std::copy(frameTimes_, frameTimes_ + count_, sorted);
+    std::sort(sorted, sorted + count_);
+    float sum = 0.0f;
+    for (int i = 0; i < count_; i++) sum += sorted[i];
+    float avg = sum / count_;
+    float p99 = sorted[std::min(count_ - 1, count_ * 99 / 100)];
+    float worst = sorted[count_ - 1];
+
+    used_ = 0;
+    float x = PERF_HUD_X, y = PERF_HUD_Y;
+    addQuad(x - 6, y - 4, 326, PERF_GRAPH_HEIGHT + 90, panel);
+
+    char line[128];
+    snprintf(line, sizeof(line), "FPS %.1f   frame avg %.2f  p99 %.2f  max %.2f ms",
+        avg > 0.0f ? 1000.0f / avg : 0.0f, avg, p99, worst);
+    addText(x, y, line, white);
+    snprintf(line, sizeof(line), "sim %.3f ms   draws %d   binds %d   fish %zu",
+        last_.simulationMs, last_.drawCalls, last_.stateChanges, last_.fishCount);
+    addText(x, y + 12, line, white);
+    // Memory in MB; a line with a category over its budget turns red.
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    MemoryUsage textures = memoryUsage(MEMORY_GPU_TEXTURES);
+    MemoryUsage buffers = memoryUsage(MEMORY_GPU_BUFFERS);
+    snprintf(line, sizeof(line), "gpu frame %.2f ms   textures %.1f   buffers %.1f MB",
+        gpu.lastFrameMs(), textures.current * mb, buffers.current * mb);
+    addText(x, y + 24, line, textures.budget && textures.current > textures.budget ? bad : white);
+    MemoryUsage fish = memoryUsage(MEMORY_FISH);
+    snprintf(line, sizeof(line), "tank %.2f  history %.1f  arenas %.1f  decode peak %.0f MB",
+        fish.current * mb, memoryUsage(MEMORY_HISTORY).current * mb,
+        memoryUsage(MEMORY_FRAME_ARENAS).current * mb, memoryUsage(MEMORY_DECODE_SCRATCH).peak * mb);
+    addText(x, y + 36, line, fish.budget && fish.current > fish.budget ? bad : white);
+
+    int written = 0;
+    line[0] = '\0';
+    for (int i = 0; i < gpu.passCount() && written < (int)sizeof(line) - 1; i++) {
+        const GpuPassStats& pass = gpu.pass(i);
+        written += snprintf(line + written, sizeof(line) - written, "%s%s %.2f", i ? "  " : "gpu ", pass.name, pass.average());
+    }
+    addText(x, y + 48, line, grey);
+
+    // Frame-time graph, oldest frame on the left.
+    float graphTop = y + 64;
+    float barWidth = 310.0f / PERF_HUD_HISTORY;
+    for (int i = 0; i < count_; i++) {
+        float ms = frameTimes_[(head_ - count_ + i + PERF_HUD_HISTORY) % PERF_HUD_HISTORY];
+        float h = std::min(ms / PERF_GRAPH_MAX_MS, 1.0f) * PERF_GRAPH_HEIGHT;
+        const unsigned char* color = ms < 17.0f ? good : (ms < 34.0f ? slow : bad);
+        addQuad(x + i * barWidth, graphTop + PERF_GRAPH_HEIGHT - h, barWidth - 0.5f, h, color);
+    }
+    // 16.7 ms reference line
+    addQuad(x, graphTop + PERF_GRAPH_HEIGHT * (1.0f - 16.7f / PERF_GRAPH_MAX_MS), 310.0f, 1.0f, grey);
+
+    float projection[16];
+    ortho(0.0f, (float)WINDOW_WIDTH, (float)WINDOW_HEIGHT, 0.0f, -1.0f, 1.0f, projection);
+    glUseProgram(program_);
+    glUniformMatrix4fv(projectionLoc_, 1, GL_FALSE, projection);
+    GLintptr offset;
+    void* memory = streamBuffer.allocate(used_, PERF_VERTEX_SIZE, offset);
+    if (!memory) return;
+    std::memcpy(memory, vertices_.data(), used_);
+    streamBuffer.commit();
+    // The renderer replaces the buffer when a frame outgrows it.
+    if (streamGeneration_ != streamBuffer.generation()) bindStreamBuffer();
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_QUADS, (GLint)(offset / PERF_VERTEX_SIZE), (GLsizei)(used_ / PERF_VERTEX_SIZE));
+    countDrawCall();
+    glBindVertexArray(0);
+}
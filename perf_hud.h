@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GpuTimer;
+
+const int PERF_HUD_HISTORY = 120; // frames shown in the frame-time graph
+
+// Draw calls issued this frame; every glDraw* call site bumps it.
+extern int perfDrawCalls;
+inline void countDrawCall() { perfDrawCalls++; }
+// Program, VAO and texture binds issued this frame by the render queue.
+extern int perfStateChanges;
+
+// Numbers for one frame, handed to the overlay after the frame is simulated.
+struct PerfFrame {
+    float frameMs;
+    float simulationMs;
+    int drawCalls;
+    int stateChanges;
+    size_t fishCount;
+};
+
+// Toggleable performance overlay (F3). All text comes from stb_easy_font and
+// the frame-time graph is made of the same unit quads as the HUD bars, but both
+// are written into one vertex stream with per-vertex colors and drawn with a
+// single call from the shared stream buffer, so the overlay barely shows up
+// in the numbers it reports. Initialize after the Renderer.
+class PerfHud {
+public:
+    void init();
+    void shutdown();
+
+    void toggle() { visible_ = !visible_; }
+    bool visible() const { return visible_; }
+
+    // Always recorded, so the graph is full as soon as the overlay opens.
+    void addFrame(const PerfFrame& frame);
+    void render(const GpuTimer& gpu);
+
+private:
+    void addText(float x, float y, const char* text, const unsigned char color[4]);
+    void addQuad(float x, float y, float w, float h, const unsigned char color[4]);
+    // Points the VAO at the stream buffer's current buffer object.
+    void bindStreamBuffer();
+
+    bool visible_ = false;
+    float frameTimes_[PERF_HUD_HISTORY] = {};
+    int head_ = 0;
+    int count_ = 0;
+    PerfFrame last_ = {};
+
+    GLuint program_ = 0;
+    GLuint vao_ = 0;
+    uint64_t streamGeneration_ = 0;  // stream buffer the VAO points at
+    GLint projectionLoc_ = -1;
+    std::vector<char> vertices_; // stb_easy_font layout: x, y, z, rgba8; copied to the stream buffer
+    size_t used_ = 0;
+};
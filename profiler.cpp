@@ -0,0 +1,163 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+thread_local ProfileThreadBuffer* profilerLocalBuffer = nullptr;
+
+// Registry of every thread that has recorded a zone. Buffers are never
+// freed, so events of finished threads can still be exported.
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<ProfileThreadBuffer>> registry;
+
+// Pairs of (raw timestamp, steady_clock) taken at start-up and at export
+// time, used to convert TSC ticks to microseconds.
+struct ProfilerClock {
+    uint64_t raw;
+    std::chrono::steady_clock::time_point steady;
+};
+
+static ProfilerClock sampleClock() {
+    return { profilerNow(), std::chrono::steady_clock::now() };
+}
+
+static const ProfilerClock profilerEpoch = sampleClock();
+static double ticksPerMicro = 1000.0;
+
+static void calibrate() {
+#ifdef AQ_PROFILER_RDTSC
+    ProfilerClock now = sampleClock();
+    double micros = std::chrono::duration<double, std::micro>(now.steady - profilerEpoch.steady).count();
+    if (micros > 1000.0) ticksPerMicro = (double)(now.raw - profilerEpoch.raw) / micros;
+    else {
+        // Too early for a good estimate; spin briefly.
+        auto until = now.steady + std::chrono::milliseconds(10);
+        while (std::chrono::steady_clock::now() < until) {}
+        calibrate();
+    }
+#endif
+}
+
+ProfileThreadBuffer* profilerRegisterThread() {
+    std::unique_ptr<ProfileThreadBuffer> buffer(new ProfileThreadBuffer());
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->tid = (uint32_t)registry.size() + 1;
+    // Threads that record before naming themselves (PROFILE_THREAD_NAME) get
+    // a placeholder; which thread registers first is not to be relied on.
+    buffer->name = "Thread " + std::to_string(buffer->tid);
+    profilerLocalBuffer = buffer.get();
+    registry.push_back(std::move(buffer));
+    return profilerLocalBuffer;
+}
+
+ProfileThreadBuffer* profilerCreateTrack(const char* name) {
+    std::unique_ptr<ProfileThreadBuffer> track(new ProfileThreadBuffer());
+    std::lock_guard<std::mutex> lock(registryMutex);
+    track->tid = (uint32_t)registry.size() + 1;
+    track->name = name;
+    track->nanosecondTimestamps = true;
+    registry.push_back(std::move(track));
+    return registry.back().get();
+}
+
+void profilerRecordOn(ProfileThreadBuffer* track, const char* name, uint64_t startNanos, uint64_t endNanos) {
+    uint64_t n = track->count.load(std::memory_order_relaxed);
+    ProfileEvent& e = track->events[n & (PROFILE_EVENTS_PER_THREAD - 1)];
+    e.name = name;
+    e.start = startNanos;
+    e.end = endNanos;
+    track->count.store(n + 1, std::memory_order_release);
+}
+
+void profilerSetThreadName(const char* name) {
+    ProfileThreadBuffer* buffer = profilerLocalBuffer ? profilerLocalBuffer : profilerRegisterThread();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->name = name;
+}
+
+uint64_t profilerSteadyNanos() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - profilerEpoch.steady).count();
+}
+
+double profilerToMicros(uint64_t timestamp) {
+    int64_t delta = (int64_t)(timestamp - profilerEpoch.raw);
+#ifdef AQ_PROFILER_RDTSC
+    return delta / ticksPerMicro;
+#else
+    return delta / 1000.0;
+#endif
+}
+
+static void writeJsonString(std::ofstream& file, const std::string& s) {
+    file << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') file << '\\';
+        file << c;
+    }
+    file << '"';
+}
+
+bool profilerExportChromeTrace(const char* path) {
+#ifndef AQ_PROFILE
+    std::cerr << "Profiler is compiled out; rebuild with AQ_PROFILE to record zones\n";
+#endif
+    calibrate();
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(3);
+
+    std::vector<ProfileEvent> events;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& buffer : registry) {
+        if (!first) file << ",\n";
+        first = false;
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+        writeJsonString(file, buffer->name);
+        file << "}}";
+
+        // Copy the live part of the ring, then drop anything the owning
+        // thread may have overwritten while we were copying. An event is
+        // written before count moves past it, so the slot at `after` may be
+        // half-written too, and one more slot is dropped for it.
+        uint64_t end = buffer->count.load(std::memory_order_acquire);
+        uint64_t begin = end > PROFILE_EVENTS_PER_THREAD ? end - PROFILE_EVENTS_PER_THREAD : 0;
+        events.clear();
+        for (uint64_t i = begin; i < end; i++) {
+            events.push_back(buffer->events[i & (PROFILE_EVENTS_PER_THREAD - 1)]);
+        }
+        uint64_t after = buffer->count.load(std::memory_order_acquire);
+        uint64_t valid = after + 1 > PROFILE_EVENTS_PER_THREAD ? after + 1 - PROFILE_EVENTS_PER_THREAD : 0;
+        size_t skip = valid > begin ? (size_t)(valid - begin) : 0;
+
+        for (size_t i = skip; i < events.size(); i++) {
+            const ProfileEvent& e = events[i];
+            double ts, dur;
+            if (buffer->nanosecondTimestamps) {
+                ts = e.start / 1000.0;
+                dur = (e.end - e.start) / 1000.0;
+            }
+            else {
+                ts = profilerToMicros(e.start);
+                dur = profilerToMicros(e.end) - ts;
+            }
+            file << ",\n{\"name\":";
+            writeJsonString(file, e.name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+        }
+    }
+    file << "\n]}\n";
+    std::cout << "Wrote trace to " << path << "\n";
+    return (bool)file;
+}
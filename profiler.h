@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define AQ_PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define AQ_PROFILER_RDTSC 1
+#else
+#include <chrono>
+#endif
+
+// Scoped CPU profiler. Build with AQ_PROFILE defined to compile the zones
+// in; without it PROFILE_SCOPE expands to nothing.
+//
+// Each thread appends completed zones to its own ring of
+// PROFILE_EVENTS_PER_THREAD events, so recording takes no locks. Nested
+// zones need no bookkeeping: the trace viewer nests them by time.
+// profilerExportChromeTrace writes the most recent events of every thread
+// in Chrome trace event format, loadable in about:tracing or Perfetto.
+
+const size_t PROFILE_EVENTS_PER_THREAD = 1 << 16;
+const char* const TRACE_FILE = "aquarium_trace.json"; // written on F2
+
+struct ProfileEvent {
+    const char* name; // must point to a string literal
+    uint64_t start;
+    uint64_t end;
+};
+
+struct ProfileThreadBuffer {
+    uint32_t tid = 0;
+    std::string name;
+    bool nanosecondTimestamps = false; // events hold ns since profiler start, not raw ticks
+    std::atomic<uint64_t> count{ 0 }; // events ever written; slot is count % capacity
+    ProfileEvent events[PROFILE_EVENTS_PER_THREAD];
+};
+
+// Raw timestamp: TSC ticks where available, steady_clock nanoseconds otherwise.
+inline uint64_t profilerNow() {
+#ifdef AQ_PROFILER_RDTSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+ProfileThreadBuffer* profilerRegisterThread();
+extern thread_local ProfileThreadBuffer* profilerLocalBuffer;
+
+inline void profilerRecord(const char* name, uint64_t start, uint64_t end) {
+    ProfileThreadBuffer* buffer = profilerLocalBuffer;
+    if (!buffer) buffer = profilerRegisterThread();
+    uint64_t n = buffer->count.load(std::memory_order_relaxed);
+    ProfileEvent& e = buffer->events[n & (PROFILE_EVENTS_PER_THREAD - 1)];
+    e.name = name;
+    e.start = start;
+    e.end = end;
+    buffer->count.store(n + 1, std::memory_order_release);
+}
+
+// Names the calling thread in exported traces.
+void profilerSetThreadName(const char* name);
+
+// Creates an extra track for events that are not timed on a CPU thread,
+// such as GPU passes. Its events carry nanoseconds since profiler start and
+// must be recorded from a single thread with profilerRecordOn.
+ProfileThreadBuffer* profilerCreateTrack(const char* name);
+void profilerRecordOn(ProfileThreadBuffer* track, const char* name, uint64_t startNanos, uint64_t endNanos);
+
+// Converts a profilerNow() value to microseconds since profiler start.
+double profilerToMicros(uint64_t timestamp);
+// Current time in nanoseconds since profiler start, on the steady clock.
+uint64_t profilerSteadyNanos();
+
+bool profilerExportChromeTrace(const char* path);
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : name_(name), start_(profilerNow()) {}
+    ~ProfileScope() { profilerRecord(name_, start_, profilerNow()); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+};
+
+#define AQ_PROFILE_CONCAT_INNER(a, b) a##b
+#define AQ_PROFILE_CONCAT(a, b) AQ_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef AQ_PROFILE
+#define PROFILE_SCOPE(name) ProfileScope AQ_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) profilerSetThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,44 @@
+#include <vector>
+
+#include "aquarium.h"
+
+#define STB_EASY_FONT_IMPLEMENTATION
+#include "stb_easy_font.h"
+
+// Orthographic Projection Matrix
+void ortho(float left, float right, float bottom, float top, float near, float far, float* mat) {
+    for (int i = 0; i < 16; i++) mat[i] = 0;
+    mat[0] = 2.f / (right - left);
+    mat[5] = 2.f / (top - bottom);
+    mat[10] = -2.f / (far - near);
+    mat[12] = -(right + left) / (right - left);
+    mat[13] = -(top + bottom) / (top - bottom);
+    mat[14] = -(far + near) / (far - near);
+    mat[15] = 1.f;
+}
+
+// Text Layout
+template <typename Vector>
+static int layoutTextInto(float x, float y, const char* text, float scale, Vector& verts) {
+    static char buffer[99999];
+    int num_quads = stb_easy_font_print(x, y, const_cast<char*>(text), NULL, buffer, sizeof(buffer));
+
+    // Use a vector to store the scaled vertices for cleaner drawing
+    verts.clear();
+    verts.reserve(num_quads * 4 * 2); // 4 vertices per quad, 2 floats per vertex
+
+    for (int i = 0; i < num_quads * 4; ++i) {
+        float* vert_data = (float*)(buffer + i * 16); // Each vertex is 16 bytes (x,y,z,w) - we only need x,y
+        verts.push_back(vert_data[0] * scale);
+        verts.push_back(vert_data[1] * scale);
+    }
+    return num_quads;
+}
+
+int layoutText(float x, float y, const char* text, float scale, std::vector<float>& verts) {
+    return layoutTextInto(x, y, text, scale, verts);
+}
+
+int layoutText(float x, float y, const char* text, float scale, FrameVector<float>& verts) {
+    return layoutTextInto(x, y, text, scale, verts);
+}
@@ -0,0 +1,139 @@
+#include "render_queue.h"
+
+#include "perf_hud.h"
+
+// Key layout, most significant first: layer (8 bits), program, texture and
+// VAO (16 bits each, GL names are small integers in practice), 8 spare bits.
+static uint64_t makeSortKey(RenderLayer layer, GLuint program, GLuint texture, GLuint vao) {
+    return ((uint64_t)layer << 56)
+        | ((uint64_t)(program & 0xFFFF) << 40)
+        | ((uint64_t)(texture & 0xFFFF) << 24)
+        | ((uint64_t)(vao & 0xFFFF) << 8);
+}
+
+// GLStateCache
+
+void GLStateCache::invalidate() {
+    program_ = ~0u;
+    vao_ = ~0u;
+    texture_ = ~0u;
+    changes_ = 0;
+}
+
+void GLStateCache::useProgram(GLuint program) {
+    if (program == program_) return;
+    glUseProgram(program);
+    program_ = program;
+    changes_++;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+    if (vao == vao_) return;
+    glBindVertexArray(vao);
+    vao_ = vao;
+    changes_++;
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture) {
+    if (texture == texture_) return;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(target, texture);
+    texture_ = texture;
+    changes_++;
+}
+
+// RenderQueue
+
+void RenderQueue::clear() {
+    // Last frame's lists went with its arena; size the new one like it.
+    size_t previous = packets_.size();
+    packets_ = FrameVector<DrawPacket>();
+    packets_.reserve(previous);
+}
+
+DrawPacket& RenderQueue::submit(RenderLayer layer, GLuint program, GLuint texture, GLuint vao,
+    GLenum mode, GLint first, GLsizei count) {
+    packets_.emplace_back();
+    DrawPacket& packet = packets_.back();
+    packet.key = makeSortKey(layer, program, texture, vao);
+    packet.program = program;
+    packet.texture = texture;
+    packet.textureTarget = GL_TEXTURE_2D;
+    packet.vao = vao;
+    packet.mode = mode;
+    packet.first = first;
+    packet.count = count;
+    packet.instanceCount = 0;
+    packet.instances = nullptr;
+    packet.instanceOffset = 0;
+    packet.uniformCount = 0;
+    return packet;
+}
+
+void RenderQueue::sort() {
+    size_t n = packets_.size();
+    order_ = FrameVector<uint32_t>(n);
+    scratch_ = FrameVector<uint32_t>(n);
+    for (size_t i = 0; i < n; i++) order_[i] = (uint32_t)i;
+
+    // One counting pass per key byte, least significant first. Bytes that
+    // are the same in every key are skipped, which with a handful of
+    // programs and textures leaves only two or three real passes.
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (size_t i = 0; i < n; i++) counts[(packets_[i].key >> shift) & 0xFF]++;
+        if (n == 0 || counts[(packets_[0].key >> shift) & 0xFF] == n) continue;
+
+        size_t offsets[256];
+        size_t sum = 0;
+        for (int b = 0; b < 256; b++) {
+            offsets[b] = sum;
+            sum += counts[b];
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint32_t index = order_[i];
+            scratch_[offsets[(packets_[index].key >> shift) & 0xFF]++] = index;
+        }
+        order_.swap(scratch_);
+    }
+
+    // Layer boundaries in the sorted order, for execute().
+    size_t at = 0;
+    for (int layer = 0; layer < RENDER_LAYER_COUNT; layer++) {
+        layerStart_[layer] = at;
+        while (at < n && (int)(packets_[order_[at]].key >> 56) == layer) at++;
+    }
+    layerStart_[RENDER_LAYER_COUNT] = n;
+}
+
+void RenderQueue::execute(RenderLayer first, RenderLayer last, GLStateCache& state) {
+    for (size_t i = layerStart_[first]; i < layerStart_[last + 1]; i++) {
+        const DrawPacket& packet = packets_[order_[i]];
+        state.useProgram(packet.program);
+        state.bindVertexArray(packet.vao);
+        if (packet.texture) state.bindTexture(packet.textureTarget, packet.texture);
+        for (int u = 0; u < packet.uniformCount; u++) {
+            const PacketUniform& uniform = packet.uniforms[u];
+            switch (uniform.type) {
+            case UNIFORM_1I: glUniform1i(uniform.location, (int)uniform.v[0]); break;
+            case UNIFORM_1F: glUniform1f(uniform.location, uniform.v[0]); break;
+            case UNIFORM_2F: glUniform2f(uniform.location, uniform.v[0], uniform.v[1]); break;
+            case UNIFORM_3F: glUniform3f(uniform.location, uniform.v[0], uniform.v[1], uniform.v[2]); break;
+            }
+        }
+        if (packet.instanceCount > 0) {
+            const InstanceLayout& layout = *packet.instances;
+            glBindBuffer(GL_ARRAY_BUFFER, layout.buffer);
+            for (int a = 0; a < layout.attributeCount; a++) {
+                const InstanceAttribute& attribute = layout.attributes[a];
+                glVertexAttribPointer(attribute.index, attribute.size, GL_FLOAT, GL_FALSE, layout.stride,
+                    (void*)(packet.instanceOffset + attribute.offset));
+            }
+            glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.instanceCount);
+        }
+        else {
+            glDrawArrays(packet.mode, packet.first, packet.count);
+        }
+        countDrawCall();
+    }
+}
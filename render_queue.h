@@ -0,0 +1,131 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "frame_arena.h"
+
+// Layers draw in this order; within a layer, packets are grouped by program,
+// texture and VAO, and packets with equal state keep their submission order.
+enum RenderLayer {
+    LAYER_BACKGROUND,
+    LAYER_RESTING_FISH, // drawn into their static layer, only when it is stale
+    LAYER_FISH,
+    LAYER_WATER_OVERLAY, // caustic light added over the scene below the HUD
+    LAYER_HUD,          // HUD layers, too, go into a static layer
+    LAYER_HUD_TEXT,     // after every HUD shape, so labels stay on top of bars
+    LAYER_OVERLAY,      // live text over the cached HUD
+    RENDER_LAYER_COUNT,
+};
+
+const int DRAW_PACKET_UNIFORMS = 4;
+
+enum PacketUniformType : uint8_t {
+    UNIFORM_1I,
+    UNIFORM_1F,
+    UNIFORM_2F,
+    UNIFORM_3F,
+};
+
+struct PacketUniform {
+    GLint location;
+    PacketUniformType type;
+    float v[3];
+};
+
+// Per-instance float attributes of an instanced draw. The packet supplies the
+// byte offset of its first instance, and the attributes are pointed there
+// right before the draw, so batches can live anywhere in a streamed buffer.
+struct InstanceAttribute {
+    GLuint index;
+    GLint size;         // floats
+    size_t offset;      // bytes into the instance
+};
+
+struct InstanceLayout {
+    GLuint buffer;
+    GLsizei stride;
+    int attributeCount;
+    InstanceAttribute attributes[4];
+};
+
+// One draw call and the per-draw uniforms it needs. Uniforms that stay the
+// same for a program all frame (projections, samplers) are set once when the
+// program is created instead of being carried by every packet.
+struct DrawPacket {
+    uint64_t key;
+    GLuint program;
+    GLuint texture;     // bound to unit 0; 0 for none
+    GLenum textureTarget;
+    GLuint vao;
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+    GLsizei instanceCount;              // 0 for a plain draw
+    const InstanceLayout* instances;
+    GLintptr instanceOffset;
+    int uniformCount;
+    PacketUniform uniforms[DRAW_PACKET_UNIFORMS];
+
+    void set1i(GLint location, int x) { add(location, UNIFORM_1I, (float)x, 0.0f, 0.0f); }
+    void set1f(GLint location, float x) { add(location, UNIFORM_1F, x, 0.0f, 0.0f); }
+    void set2f(GLint location, float x, float y) { add(location, UNIFORM_2F, x, y, 0.0f); }
+    void set3f(GLint location, float x, float y, float z) { add(location, UNIFORM_3F, x, y, z); }
+
+private:
+    void add(GLint location, PacketUniformType type, float x, float y, float z) {
+        if (uniformCount == DRAW_PACKET_UNIFORMS) return;
+        PacketUniform& u = uniforms[uniformCount++];
+        u.location = location;
+        u.type = type;
+        u.v[0] = x;
+        u.v[1] = y;
+        u.v[2] = z;
+    }
+};
+
+// Remembers the bound program, VAO and texture so binds that would not change
+// anything are skipped. Invalidate whenever other code may have touched GL.
+class GLStateCache {
+public:
+    void invalidate();
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindTexture(GLenum target, GLuint texture);
+
+    // Binds actually issued since the last invalidate().
+    int changes() const { return changes_; }
+
+private:
+    GLuint program_ = ~0u;
+    GLuint vao_ = ~0u;
+    GLuint texture_ = ~0u;
+    int changes_ = 0;
+};
+
+// Per-frame list of draw packets. Passes submit in any order; sort() orders
+// them by key with a stable LSD radix sort, and execute() issues them through
+// the state cache, so the number of binds depends on how many distinct
+// programs, textures and VAOs are used rather than on how many things are drawn.
+// The lists live in the frame arena, so a queue is filled, sorted and executed
+// within one frame and cleared at the start of the next.
+class RenderQueue {
+public:
+    void clear();
+    DrawPacket& submit(RenderLayer layer, GLuint program, GLuint texture, GLuint vao,
+        GLenum mode, GLint first, GLsizei count);
+
+    void sort();
+    // Draws the sorted packets of layers [first, last].
+    void execute(RenderLayer first, RenderLayer last, GLStateCache& state);
+
+    size_t size() const { return packets_.size(); }
+
+private:
+    FrameVector<DrawPacket> packets_;
+    FrameVector<uint32_t> order_;
+    FrameVector<uint32_t> scratch_;
+    size_t layerStart_[RENDER_LAYER_COUNT + 1] = {};
+};
@@ -0,0 +1,553 @@
+#include "renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "gpu_timer.h"
+#include "memory_budget.h"
+#include "perf_hud.h"
+#include "profiler.h"
+#include "shader_cache.h"
+#include "stream_buffer.h"
+
+static_assert(FISH_SPECIES_COUNT <= FISH_MAX_SPECIES, "grow the SpeciesAnimations block with FISH_MAX_SPECIES");
+
+// Shaders
+static const char* vertexShaderSrc = R"glsl(
+#version 330 core
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec2 aTexCoord;
+layout(location = 2) in vec4 aInstance;   // x, y, size, happiness
+layout(location = 3) in vec2 aMotion;     // dx, dy
+layout(location = 4) in vec3 aSprite;     // facing (+1 right, -1 left), species, swim phase 0..1
+
+out vec2 TexCoord;
+flat out float Layer;
+out float Happiness;
+
+// Per species: first atlas layer, frame count, frames per second at cruise
+// speed. Sized to FISH_MAX_SPECIES.
+layout(std140) uniform SpeciesAnimations {
+    vec4 animations[16];
+};
+
+uniform mat4 projection;
+uniform float time;
+uniform float cruiseSpeed;
+
+void main() {
+    vec2 pos = vec2(aPos.x * aSprite.x, aPos.y) * aInstance.z + aInstance.xy;
+    gl_Position = projection * vec4(pos, 0.0, 1.0);
+    TexCoord = aTexCoord;
+
+    // Faster fish beat their tails faster; the phase keeps a school from
+    // swimming in lockstep.
+    vec4 animation = animations[int(aSprite.y)];
+    float speed = length(aMotion);
+    float rate = speed > 0.0 ? animation.z * clamp(speed / cruiseSpeed, 0.25, 2.0) : 0.0;
+    float frame = mod(floor(time * rate + aSprite.z * animation.y), animation.y);
+    Layer = animation.x + frame;
+    Happiness = aInstance.w;
+}
+)glsl";
+
+static const char* fragmentShaderSrc = R"glsl(
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+flat in float Layer;
+in float Happiness; // 0..1
+
+uniform sampler2DArray fishAtlas;
+
+void main() {
+    vec4 texColor = texture(fishAtlas, vec3(TexCoord, Layer));
+    float tint = 1.0 - Happiness;
+    vec3 colorTint = mix(vec3(1.0,1.0,1.0), vec3(1.0,0.3,0.3), tint);
+    FragColor = vec4(texColor.rgb * colorTint, texColor.a);
+    if (FragColor.a < 0.1) discard;
+}
+)glsl";
+
+static const char* uiVertexShaderSrc = R"glsl(
+#version 330 core
+layout(location=0) in vec2 aPos;
+
+uniform mat4 projection;
+uniform vec2 buttonPos;
+uniform vec2 buttonSize;
+
+void main() {
+    vec2 pos = aPos * buttonSize + buttonPos;
+    gl_Position = projection * vec4(pos, 0.0, 1.0);
+}
+)glsl";
+
+static const char* uiFragmentShaderSrc = R"glsl(
+#version 330 core
+out vec4 FragColor;
+
+uniform vec3 color;
+
+void main() {
+    FragColor = vec4(color, 1.0);
+}
+)glsl";
+
+bool Renderer::loadAssets() {
+    SpriteSheet sheets[FISH_SPECIES_COUNT];
+    for (int i = 0; i < FISH_SPECIES_COUNT; i++) {
+        sheets[i] = { FISH_SPECIES[i].sprite, FISH_SPECIES[i].sheetColumns, FISH_SPECIES[i].swimFrames };
+    }
+    return atlas_.loadTexels(sheets, FISH_SPECIES_COUNT, ATLAS_CACHE_FILE);
+}
+
+bool Renderer::init() {
+    streamBuffer.init();
+
+    // With parallel shader compilation these link on driver threads while
+    // the passes set up theirs and the atlas loads; nothing touches them
+    // until their uniforms are set at the end.
+    fishShader_ = createShaderProgram(vertexShaderSrc, fragmentShaderSrc);
+    uiShader_ = createShaderProgram(uiVertexShaderSrc, uiFragmentShaderSrc);
+    textShader_ = createTextShaderProgram();
+    if (!background_.init() || !waterOverlay_.init() || !restingFishLayer_.init() || !hudLayer_.init()) return false;
+
+    glGenVertexArrays(1, &textVAO_);
+    glBindVertexArray(textVAO_);
+    glBindBuffer(GL_ARRAY_BUFFER, streamBuffer.buffer());
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    if (atlas_.layers() == 0 && !loadAssets()) {
+        return false;
+    }
+    // The static layers and the background are sized on the first frame;
+    // leave room in the texture budget for them.
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    size_t windowBytes = (size_t)viewport[2] * viewport[3] * 4;
+    windowTextureBytes_ = 2 * windowBytes + windowBytes / (BACKGROUND_DOWNSCALE * BACKGROUND_DOWNSCALE);
+    atlas_.upload(windowTextureBytes_);
+
+    // Each species is drawn as the fan of its traced outline rather than a
+    // full quad, so the transparent corners of the sprite are never shaded.
+    std::vector<float> fishVertices;
+    for (int i = 0; i < FISH_SPECIES_COUNT; i++) {
+        const SpriteOutline& outline = atlas_.outline(i);
+        fishMeshes_[i].first = (GLint)(fishVertices.size() / 4);
+        for (int v = 1; v + 1 < outline.vertexCount; v++) {
+            for (int corner : { 0, v, v + 1 }) {
+                float u = outline.uv[corner][0], t = outline.uv[corner][1];
+                fishVertices.insert(fishVertices.end(), { u - 0.5f, t - 0.5f, u, t });
+            }
+        }
+        fishMeshes_[i].count = (GLsizei)(fishVertices.size() / 4) - fishMeshes_[i].first;
+    }
+
+    glGenVertexArrays(1, &fishVAO_);
+    glGenBuffers(1, &fishVBO_);
+    glBindVertexArray(fishVAO_);
+    glBindBuffer(GL_ARRAY_BUFFER, fishVBO_);
+    glBufferData(GL_ARRAY_BUFFER, fishVertices.size() * sizeof(float), fishVertices.data(), GL_STATIC_DRAW);
+    bufferBytes_ = fishVertices.size() * sizeof(float);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    // Per-fish attributes; the queue points them into the stream buffer
+    // at each packet's instance offset.
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
+    glBindVertexArray(0);
+    fishInstanceLayout_.buffer = streamBuffer.buffer();
+    fishInstanceLayout_.stride = sizeof(FishInstance);
+    fishInstanceLayout_.attributeCount = 3;
+    fishInstanceLayout_.attributes[0] = { 2, 4, offsetof(FishInstance, x) };
+    fishInstanceLayout_.attributes[1] = { 3, 2, offsetof(FishInstance, dx) };
+    fishInstanceLayout_.attributes[2] = { 4, 3, offsetof(FishInstance, flip) };
+
+    float uiQuad[] = {
+        0.f, 0.f,
+        1.f, 0.f,
+        1.f, 1.f,
+        0.f, 1.f,
+    };
+
+    glGenVertexArrays(1, &uiVAO_);
+    glGenBuffers(1, &uiVBO_);
+    glBindVertexArray(uiVAO_);
+    glBindBuffer(GL_ARRAY_BUFFER, uiVBO_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(uiQuad), uiQuad, GL_STATIC_DRAW);
+    bufferBytes_ += sizeof(uiQuad);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    // The animation table only changes with the species list, so it is
+    // uploaded once and the vertex shader picks every fish's frame from it.
+    float animations[FISH_MAX_SPECIES][4] = {};
+    for (int i = 0; i < FISH_SPECIES_COUNT; i++) {
+        const SpriteAnimation& animation = atlas_.animation(i);
+        animations[i][0] = (float)animation.firstLayer;
+        animations[i][1] = (float)animation.frames;
+        animations[i][2] = FISH_SPECIES[i].framesPerSecond;
+    }
+    glGenBuffers(1, &speciesUBO_);
+    glBindBuffer(GL_UNIFORM_BUFFER, speciesUBO_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(animations), animations, GL_STATIC_DRAW);
+    bufferBytes_ += sizeof(animations);
+    memoryAllocated(MEMORY_GPU_BUFFERS, bufferBytes_);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, SPECIES_ANIMATION_BINDING, speciesUBO_);
+
+    // Uniforms that never change are set once here; draw packets only
+    // carry the per-draw ones.
+    float projection[16];
+    ortho(-1.f, 1.f, -1.f, 1.f, -1.f, 1.f, projection);
+    glUseProgram(fishShader_);
+    glUniformMatrix4fv(glGetUniformLocation(fishShader_, "projection"), 1, GL_FALSE, projection);
+    glUniform1i(glGetUniformLocation(fishShader_, "fishAtlas"), 0);
+    glUniform1f(glGetUniformLocation(fishShader_, "cruiseSpeed"), FISH_CRUISE_SPEED);
+    glUniformBlockBinding(fishShader_, glGetUniformBlockIndex(fishShader_, "SpeciesAnimations"), SPECIES_ANIMATION_BINDING);
+    fishTimeLoc_ = glGetUniformLocation(fishShader_, "time");
+
+    glUseProgram(uiShader_);
+    glUniformMatrix4fv(glGetUniformLocation(uiShader_, "projection"), 1, GL_FALSE, projection);
+    uiPosLoc_ = glGetUniformLocation(uiShader_, "buttonPos");
+    uiSizeLoc_ = glGetUniformLocation(uiShader_, "buttonSize");
+    uiColorLoc_ = glGetUniformLocation(uiShader_, "color");
+
+    float textProjection[16];
+    ortho(0.0f, (float)WINDOW_WIDTH, (float)WINDOW_HEIGHT, 0.0f, -1.0f, 1.0f, textProjection);
+    glUseProgram(textShader_);
+    glUniformMatrix4fv(glGetUniformLocation(textShader_, "projection"), 1, GL_FALSE, textProjection);
+    textColorLoc_ = glGetUniformLocation(textShader_, "color");
+
+    glUseProgram(0);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    return true;
+}
+
+void Renderer::shutdown() {
+    glDeleteVertexArrays(1, &fishVAO_);
+    glDeleteBuffers(1, &fishVBO_);
+    glDeleteVertexArrays(1, &uiVAO_);
+    glDeleteBuffers(1, &uiVBO_);
+    glDeleteProgram(fishShader_);
+    glDeleteProgram(uiShader_);
+    glDeleteProgram(textShader_);
+    background_.shutdown();
+    waterOverlay_.shutdown();
+    restingFishLayer_.shutdown();
+    hudLayer_.shutdown();
+    atlas_.destroy();
+    glDeleteBuffers(1, &speciesUBO_);
+    memoryFreed(MEMORY_GPU_BUFFERS, bufferBytes_);
+    bufferBytes_ = 0;
+    glDeleteVertexArrays(1, &textVAO_);
+    streamBuffer.shutdown();
+}
+
+void Renderer::finishLoading() {
+    waterOverlay_.finishLoading();
+}
+
+void Renderer::endFrame() {
+    streamBuffer.endFrame();
+}
+
+void Renderer::render(const RenderScene& scene, GpuTimer& gpuTimer) {
+    // Packets are executed after every pass has allocated, so the whole
+    // frame's stream data has to fit its region; headroom covers the HUD.
+    if (streamBuffer.reserve(scene.fishes->size() * sizeof(FishInstance) + STREAM_HUD_HEADROOM)) {
+        glBindVertexArray(textVAO_);
+        glBindBuffer(GL_ARRAY_BUFFER, streamBuffer.buffer());
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glBindVertexArray(0);
+        fishInstanceLayout_.buffer = streamBuffer.buffer();
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    viewportWidth_ = viewport[2];
+    viewportHeight_ = viewport[3];
+
+    queue_.clear();
+    {
+        PROFILE_SCOPE("Background draw");
+        drawBackground();
+    }
+    {
+        PROFILE_SCOPE("Fish draw");
+        drawFishes(scene);
+    }
+    {
+        PROFILE_SCOPE("Water overlay draw");
+        size_t windowTextures = background_.textureBytes() + restingFishLayer_.textureBytes() + hudLayer_.textureBytes();
+        waterOverlay_.submit(queue_, scene.time,
+            windowTextureBytes_ > windowTextures ? windowTextureBytes_ - windowTextures : 0);
+    }
+    {
+        PROFILE_SCOPE("HUD");
+        drawHud(scene);
+    }
+    {
+        PROFILE_SCOPE("Render queue sort");
+        queue_.sort();
+    }
+
+    {
+        PROFILE_SCOPE("Background submit");
+        GpuZone gpuZone(gpuTimer, "Background pass");
+        background_.update(scene.time, scene.oxygen);
+        // The queue only knows the binds it made itself.
+        state_.invalidate();
+        // The water is opaque; blending it would only read back the target.
+        glDisable(GL_BLEND);
+        queue_.execute(LAYER_BACKGROUND, LAYER_BACKGROUND, state_);
+        glEnable(GL_BLEND);
+    }
+    {
+        PROFILE_SCOPE("Fish submit");
+        GpuZone gpuZone(gpuTimer, "Fish pass");
+        if (restingFishRedraw_) {
+            restingFishLayer_.beginRedraw();
+            queue_.execute(LAYER_RESTING_FISH, LAYER_RESTING_FISH, state_);
+            restingFishLayer_.endRedraw();
+        }
+        restingFishLayer_.composite(state_);
+        queue_.execute(LAYER_FISH, LAYER_FISH, state_);
+    }
+    {
+        PROFILE_SCOPE("Water overlay submit");
+        GpuZone gpuZone(gpuTimer, "Water overlay pass");
+        // The light adds to whatever is below it.
+        glBlendFunc(GL_ONE, GL_ONE);
+        queue_.execute(LAYER_WATER_OVERLAY, LAYER_WATER_OVERLAY, state_);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    {
+        PROFILE_SCOPE("HUD submit");
+        GpuZone gpuZone(gpuTimer, "HUD pass");
+        if (hudRedraw_) {
+            hudLayer_.beginRedraw();
+            queue_.execute(LAYER_HUD, LAYER_HUD_TEXT, state_);
+            hudLayer_.endRedraw();
+        }
+        hudLayer_.composite(state_);
+        queue_.execute(LAYER_OVERLAY, LAYER_OVERLAY, state_);
+    }
+    glBindVertexArray(0);
+    perfStateChanges += state_.changes();
+}
+
+void Renderer::drawBackground() {
+    background_.submit(queue_);
+}
+
+// Dead fish stop moving once they reach the bottom (see updateFish).
+static bool isResting(const Fish& f) {
+    return f.isDying && f.y <= -1.0f;
+}
+
+void Renderer::drawFishes(const RenderScene& scene) {
+    const std::vector<Fish>& fishes = *scene.fishes;
+
+    // Every species has its own mesh, so instances are grouped by species:
+    // count them, then write each fish straight into its group's range.
+    // Resting fish form groups of their own, which are only written when
+    // their static layer has to be redrawn.
+    size_t counts[2][FISH_SPECIES_COUNT] = {};
+    uint64_t restingKey = 0xcbf29ce484222325ull;
+    for (const Fish& f : fishes) {
+        int species = f.species < FISH_SPECIES_COUNT ? f.species : 0;
+        bool resting = isResting(f);
+        counts[resting][species]++;
+        if (resting) {
+            // Everything that shows: the x position, size, facing, sprite,
+            // frame and tint to the 8 bits it is drawn with.
+            uint32_t x, size;
+            std::memcpy(&x, &f.x, sizeof(x));
+            std::memcpy(&size, &f.size, sizeof(size));
+            uint64_t fields[2] = {
+                (uint64_t)x << 32 | size,
+                (uint64_t)std::lround(f.happiness * 255.0f) << 24 | (uint64_t)f.swimPhase << 16 |
+                    (uint64_t)species << 8 | (f.facingRight ? 1 : 0),
+            };
+            for (uint64_t field : fields) restingKey = (restingKey ^ field) * 0x100000001b3ull;
+        }
+    }
+    restingFishRedraw_ = restingFishLayer_.needsRedraw(restingKey, viewportWidth_, viewportHeight_);
+
+    size_t starts[2][FISH_SPECIES_COUNT];
+    size_t next[2][FISH_SPECIES_COUNT];
+    size_t total = 0;
+    for (int resting = 0; resting < 2; resting++) {
+        for (int i = 0; i < FISH_SPECIES_COUNT; i++) {
+            starts[resting][i] = next[resting][i] = total;
+            if (!resting || restingFishRedraw_) total += counts[resting][i];
+        }
+    }
+    if (total == 0) return;
+
+    GLintptr offset;
+    void* memory = streamBuffer.allocate(total * sizeof(FishInstance), sizeof(FishInstance), offset);
+    if (!memory) return;
+    FishInstance* instances = static_cast<FishInstance*>(memory);
+    for (const Fish& f : fishes) {
+        int species = f.species < FISH_SPECIES_COUNT ? f.species : 0;
+        bool resting = isResting(f);
+        if (resting && !restingFishRedraw_) continue;
+        if (resting) {
+            float half = f.size * 0.5f;
+            restingFishLayer_.cover(f.x - half, f.y - half, f.x + half, f.y + half);
+        }
+        FishInstance& instance = instances[next[resting][species]++];
+        instance.x = f.x;
+        instance.y = f.y;
+        instance.size = f.size;
+        instance.happiness = f.happiness;
+        // Dying fish hold their frame, so a fish that comes to rest looks
+        // the same in the static layer as it did sinking.
+        instance.dx = f.isDying ? 0.0f : f.dx;
+        instance.dy = f.isDying ? 0.0f : f.dy;
+        instance.flip = f.facingRight ? 1.0f : -1.0f;
+        instance.species = (float)species;
+        instance.phase = f.swimPhase * (1.0f / FISH_SWIM_PHASES);
+    }
+    streamBuffer.commit();
+
+    for (int resting = 0; resting < 2; resting++) {
+        if (resting && !restingFishRedraw_) break;
+        for (int i = 0; i < FISH_SPECIES_COUNT; i++) {
+            if (counts[resting][i] == 0) continue;
+            DrawPacket& packet = queue_.submit(resting ? LAYER_RESTING_FISH : LAYER_FISH, fishShader_,
+                atlas_.texture(), fishVAO_, GL_TRIANGLES, fishMeshes_[i].first, fishMeshes_[i].count);
+            packet.textureTarget = GL_TEXTURE_2D_ARRAY;
+            packet.instances = &fishInstanceLayout_;
+            packet.instanceOffset = offset + (GLintptr)(starts[resting][i] * sizeof(FishInstance));
+            packet.instanceCount = (GLsizei)counts[resting][i];
+            packet.set1f(fishTimeLoc_, scene.time);
+        }
+    }
+}
+
+void Renderer::drawHud(const RenderScene& scene) {
+    float barHeight = 0.05f;
+    float barWidth = 0.5f;
+    float barY = 0.9f;
+    float barX = -0.9f;
+
+    if (scene.overlayText) {
+        drawText(260, 20, scene.overlayText, 1.0f, 1.0f, 0.4f, 1.0f, LAYER_OVERLAY);
+    }
+
+    // The rest of the HUD only changes when a bar grows or shrinks by a pixel.
+    long foodPixels = std::lround(barWidth * scene.food * 0.5f * viewportWidth_);
+    long oxygenPixels = std::lround(barWidth * scene.oxygen * 0.5f * viewportWidth_);
+    hudRedraw_ = hudLayer_.needsRedraw((uint64_t)foodPixels << 32 | (uint64_t)oxygenPixels, viewportWidth_, viewportHeight_);
+    if (!hudRedraw_) return;
+
+    // Render food level bar
+    drawBar(barX, barY, barWidth * scene.food, barHeight, 1.0f, 0.6f, 0.0f, barWidth, true);
+    drawText(30, (1.0f - (barY + 1.0f) / 2.0f) * WINDOW_HEIGHT, "Food", 1.0f, 1.0f, 1.0f, 1.0f);
+    barY -= barHeight + 0.05f;
+
+    // Render oxygen level bar
+    drawBar(barX, barY, barWidth * scene.oxygen, barHeight, 0.0f, 0.8f, 0.8f, barWidth, true);
+    drawText(30, (1.0f - (barY + 1.0f) / 2.0f) * WINDOW_HEIGHT, "Oxygen", 1.0f, 1.0f, 1.0f, 1.0f);
+
+    // Render buttons
+    drawBar(feedButton.x, feedButton.y, feedButton.width, feedButton.height, 1.0f, 0.6f, 0.0f, feedButton.width, true);
+    drawText((feedButton.x + 1.0f) / 2.0f * WINDOW_WIDTH + 10,
+        (1.0f - (feedButton.y + 1.0f) / 2.0f) * WINDOW_HEIGHT - 35,
+        feedButton.label, 1.f, 1.f, 1.f, 1.5f);
+
+    drawBar(oxygenButton.x, oxygenButton.y, oxygenButton.width, oxygenButton.height, 0.0f, 0.8f, 0.8f, oxygenButton.width, true);
+    drawText((oxygenButton.x + 1.0f) / 2.0f * WINDOW_WIDTH + 10,
+        (1.0f - (oxygenButton.y + 1.0f) / 2.0f) * WINDOW_HEIGHT - 35,
+        oxygenButton.label, 1.f, 1.f, 1.f, 1.5f);
+}
+
+void Renderer::drawBar(float x, float y, float width, float height, float r, float g, float b, float maxWidth, bool withBackground) {
+    hudLayer_.cover(x, y, x + (withBackground ? maxWidth : width), y + height);
+    if (withBackground) {
+        // Dark background bar; same key as the bar itself, so it stays first
+        DrawPacket& background = queue_.submit(LAYER_HUD, uiShader_, 0, uiVAO_, GL_TRIANGLE_FAN, 0, 4);
+        background.set2f(uiPosLoc_, x, y);
+        background.set2f(uiSizeLoc_, maxWidth, height);
+        background.set3f(uiColorLoc_, 0.2f, 0.2f, 0.2f);
+    }
+
+    DrawPacket& bar = queue_.submit(LAYER_HUD, uiShader_, 0, uiVAO_, GL_TRIANGLE_FAN, 0, 4);
+    bar.set2f(uiPosLoc_, x, y);
+    bar.set2f(uiSizeLoc_, width, height);
+    bar.set3f(uiColorLoc_, r, g, b);
+}
+
+void Renderer::drawText(float x, float y, const char* text, float r, float g, float b, float scale, RenderLayer layer) {
+    FrameVector<float> text_verts;
+    int num_quads = layoutText(x, y, text, scale, text_verts);
+    if (num_quads == 0) return;
+
+    if (layer != LAYER_OVERLAY) {
+        // Text vertices are in window pixels, y down.
+        float minX = text_verts[0], maxX = text_verts[0], minY = text_verts[1], maxY = text_verts[1];
+        for (size_t i = 2; i < text_verts.size(); i += 2) {
+            minX = std::min(minX, text_verts[i]);
+            maxX = std::max(maxX, text_verts[i]);
+            minY = std::min(minY, text_verts[i + 1]);
+            maxY = std::max(maxY, text_verts[i + 1]);
+        }
+        hudLayer_.cover(minX / WINDOW_WIDTH * 2.0f - 1.0f, 1.0f - maxY / WINDOW_HEIGHT * 2.0f,
+            maxX / WINDOW_WIDTH * 2.0f - 1.0f, 1.0f - minY / WINDOW_HEIGHT * 2.0f);
+    }
+
+    // Vertices go into the stream buffer at a multiple of the vertex size,
+    // so the draw can start there without re-pointing the VAO.
+    const size_t stride = 2 * sizeof(float);
+    GLintptr offset;
+    void* memory = streamBuffer.allocate(text_verts.size() * sizeof(float), stride, offset);
+    if (!memory) return;
+    memcpy(memory, text_verts.data(), text_verts.size() * sizeof(float));
+    streamBuffer.commit();
+
+    DrawPacket& packet = queue_.submit(layer, textShader_, 0, textVAO_, GL_QUADS, (GLint)(offset / stride), num_quads * 4);
+    packet.set3f(textColorLoc_, r, g, b);
+}
+
+// Shader Compilation and Program Linking
+GLuint createShaderProgram(const char* vtxSrc, const char* fragSrc) {
+    return shaderCache.createProgram(vtxSrc, fragSrc);
+}
+
+GLuint createTextShaderProgram() {
+    const char* vertexShaderSource = R"(
+        #version 330 core
+        layout(location=0) in vec2 aPos;
+        uniform mat4 projection;
+        void main() {
+            gl_Position = projection * vec4(aPos, 0.0, 1.0);
+        }
+    )";
+    const char* fragmentShaderSource = R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform vec3 color;
+        void main() {
+            FragColor = vec4(color, 1.0);
+        }
+    )";
+    return createShaderProgram(vertexShaderSource, fragmentShaderSource);
+}
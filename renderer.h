@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+#include "aquarium.h"
+#include "background.h"
+#include "render_queue.h"
+#include "sprite_atlas.h"
+#include "static_layer.h"
+#include "water_overlay.h"
+
+class GpuTimer;
+
+// One frame's worth of tank state. The live loop, rewind and the offscreen
+// benchmark fill this in and all draw through Renderer::render.
+struct RenderScene {
+    const std::vector<Fish>* fishes = nullptr;
+    float oxygen = 0.0f;
+    float food = 0.0f;
+    float time = 0.0f;                  // seconds; drives the background waves
+    const char* overlayText = nullptr;  // status line along the top, if set
+};
+
+// Per-fish vertex attributes of the instanced fish draw, streamed every frame.
+// They are copied straight from Fish; the swim frame is picked on the GPU.
+struct FishInstance {
+    float x, y, size, happiness;
+    float dx, dy;
+    float flip;     // +1 facing right, -1 facing left
+    float species;
+    float phase;    // 0..1 into the swim cycle
+};
+
+const GLuint SPECIES_ANIMATION_BINDING = 0;    // uniform buffer binding point
+const size_t STREAM_HUD_HEADROOM = 256 * 1024;  // text and HUD bytes per frame
+
+// Owns the shaders, quads and sprite atlas of the tank, and the stream buffer
+// shared by all dynamic vertex data, and draws the background, fish and HUD
+// passes into the current framebuffer. Passes submit draw packets to a
+// RenderQueue, which is sorted and executed once all of them are in.
+// The HUD and the dead fish resting on the bottom live in StaticLayers and
+// are only submitted on frames where what they show has changed.
+class Renderer {
+public:
+    // Loads the sprite atlas texels without touching GL, so startup can run
+    // it on a worker thread while the context is created. init() calls it
+    // itself if nothing was loaded yet.
+    bool loadAssets();
+    bool init();
+    void shutdown();
+    // Waits for assets that keep loading after init(), so every frame from
+    // the first on looks the same; the window does not wait for them.
+    void finishLoading();
+
+    void render(const RenderScene& scene, GpuTimer& gpuTimer);
+    // Call after the frame's last draw, including overlays drawn outside render().
+    void endFrame();
+
+private:
+    void drawBackground();
+    void drawFishes(const RenderScene& scene);
+    void drawHud(const RenderScene& scene);
+    void drawBar(float x, float y, float width, float height, float r, float g, float b, float maxWidth, bool withBackground);
+    void drawText(float x, float y, const char* text, float r, float g, float b, float scale,
+        RenderLayer layer = LAYER_HUD_TEXT);
+
+    GLuint fishShader_ = 0;
+    GLuint uiShader_ = 0;
+    GLuint textShader_ = 0;
+    GLuint fishVAO_ = 0, fishVBO_ = 0;
+    GLuint uiVAO_ = 0, uiVBO_ = 0;
+    GLuint textVAO_ = 0;
+    BackgroundPass background_;
+    WaterOverlayPass waterOverlay_;
+    StaticLayer restingFishLayer_;
+    StaticLayer hudLayer_;
+    bool restingFishRedraw_ = false;
+    bool hudRedraw_ = false;
+    int viewportWidth_ = 0, viewportHeight_ = 0;
+    SpriteAtlas atlas_;
+    struct FishMesh {
+        GLint first = 0;
+        GLsizei count = 0;
+    } fishMeshes_[FISH_SPECIES_COUNT];
+    GLuint speciesUBO_ = 0;
+    size_t bufferBytes_ = 0;    // fish meshes, UI quad and species table
+    size_t windowTextureBytes_ = 0; // what the window-sized textures take once all are made
+    InstanceLayout fishInstanceLayout_;
+
+    GLint fishTimeLoc_ = -1;
+    GLint uiPosLoc_ = -1, uiSizeLoc_ = -1, uiColorLoc_ = -1;
+    GLint textColorLoc_ = -1;
+
+    RenderQueue queue_;
+    GLStateCache state_;
+};
@@ -0,0 +1,179 @@
+#include "shader_cache.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "atomic_file.h"
+#include "gl_extensions.h"
+#include "mapped_file.h"
+#include "profiler.h"
+#include "snapshot.h"
+
+static_assert(sizeof(ShaderCacheHeader) == 32, "ShaderCacheHeader must stay 32 bytes");
+static_assert(sizeof(ShaderCacheEntry) == 16, "ShaderCacheEntry is cached as is");
+
+ShaderCache shaderCache;
+
+static uint64_t hashString(uint64_t hash, const char* text) {
+    size_t length = text ? std::strlen(text) : 0;
+    hash = (hash ^ snapshotChecksum(text, length)) * 0x100000001b3ull;
+    return (hash ^ length) * 0x100000001b3ull;
+}
+
+// Starts compiling; the status is only checked once the program is finished.
+static GLuint startShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+static void reportShaderErrors(GLuint shader) {
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char info[512];
+        glGetShaderInfoLog(shader, 512, nullptr, info);
+        std::cerr << "Shader compile error:\n" << info << std::endl;
+    }
+}
+
+void ShaderCache::load(const char* path) {
+    PROFILE_SCOPE("Shader cache load");
+    path_ = path;
+    binaries_.clear();
+    dirty_ = false;
+    // Let the driver pick how many threads compile in the background.
+    if (glExt.parallelShaderCompile) glExt.MaxShaderCompilerThreads(0xFFFFFFFFu);
+    if (!glExt.programBinary) return;
+
+    driverHash_ = 0xcbf29ce484222325ull;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        driverHash_ = hashString(driverHash_, (const char*)glGetString(name));
+    }
+
+    MappedFile file;
+    if (!file.open(path)) return;
+    ShaderCacheHeader header;
+    if (file.size() < sizeof(header)) return;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != SHADER_CACHE_MAGIC || header.version != SHADER_CACHE_VERSION ||
+        header.headerSize != sizeof(header) || header.driverHash != driverHash_) {
+        return;
+    }
+    const uint8_t* payload = file.data() + sizeof(header);
+    size_t payloadSize = file.size() - sizeof(header);
+    if (snapshotChecksum(payload, payloadSize) != header.payloadChecksum) {
+        std::cerr << "Shader cache " << path << " is corrupt, recompiling\n";
+        return;
+    }
+    size_t offset = 0;
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        ShaderCacheEntry entry;
+        if (payloadSize - offset < sizeof(entry)) break;
+        std::memcpy(&entry, payload + offset, sizeof(entry));
+        offset += sizeof(entry);
+        if (payloadSize - offset < entry.size) break;
+        Binary& binary = binaries_[entry.sourceHash];
+        binary.format = entry.format;
+        binary.data.assign(payload + offset, payload + offset + entry.size);
+        offset += entry.size;
+    }
+}
+
+GLuint ShaderCache::createProgram(const char* vertexSrc, const char* fragmentSrc) {
+    uint64_t sourceHash = hashString(hashString(0xcbf29ce484222325ull, vertexSrc), fragmentSrc);
+    GLuint program = glCreateProgram();
+
+    auto cached = binaries_.find(sourceHash);
+    if (cached != binaries_.end()) {
+        const Binary& binary = cached->second;
+        glExt.ProgramBinary(program, binary.format, binary.data.data(), (GLsizei)binary.data.size());
+        int linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked) {
+            cachedPrograms_++;
+            return program;
+        }
+        // Rejected anyway, as after a driver update that kept its version
+        // string; the program is relinked from source below.
+        binaries_.erase(cached);
+        dirty_ = true;
+    }
+
+    Pending pending;
+    pending.program = program;
+    pending.vertex = startShader(GL_VERTEX_SHADER, vertexSrc);
+    pending.fragment = startShader(GL_FRAGMENT_SHADER, fragmentSrc);
+    pending.sourceHash = sourceHash;
+    glAttachShader(program, pending.vertex);
+    glAttachShader(program, pending.fragment);
+    if (glExt.programBinary) glExt.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    compiledPrograms_++;
+
+    // Without parallel compilation the link has already finished; checking
+    // now keeps errors next to the program that caused them.
+    if (glExt.parallelShaderCompile) pending_.push_back(pending);
+    else finish(pending);
+    return program;
+}
+
+void ShaderCache::finish(const Pending& pending) {
+    int success;
+    glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+    if (!success) {
+        reportShaderErrors(pending.vertex);
+        reportShaderErrors(pending.fragment);
+        char info[512];
+        glGetProgramInfoLog(pending.program, 512, nullptr, info);
+        std::cerr << "Shader link error:\n" << info << std::endl;
+    }
+    else if (glExt.programBinary) {
+        GLint length = 0;
+        glGetProgramiv(pending.program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length > 0) {
+            Binary& binary = binaries_[pending.sourceHash];
+            binary.data.resize(length);
+            glExt.GetProgramBinary(pending.program, length, &length, &binary.format, binary.data.data());
+            binary.data.resize(length);
+            dirty_ = true;
+        }
+    }
+    glDetachShader(pending.program, pending.vertex);
+    glDetachShader(pending.program, pending.fragment);
+    glDeleteShader(pending.vertex);
+    glDeleteShader(pending.fragment);
+}
+
+void ShaderCache::flush() {
+    PROFILE_SCOPE("Shader cache flush");
+    for (const Pending& pending : pending_) finish(pending);
+    pending_.clear();
+    if (dirty_ && !path_.empty() && glExt.programBinary) write();
+    dirty_ = false;
+}
+
+void ShaderCache::write() {
+    std::vector<uint8_t> payload;
+    for (const auto& cached : binaries_) {
+        ShaderCacheEntry entry = { cached.first, cached.second.format, (uint32_t)cached.second.data.size() };
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&entry);
+        payload.insert(payload.end(), bytes, bytes + sizeof(entry));
+        payload.insert(payload.end(), cached.second.data.begin(), cached.second.data.end());
+    }
+    ShaderCacheHeader header = {};
+    header.magic = SHADER_CACHE_MAGIC;
+    header.version = SHADER_CACHE_VERSION;
+    header.headerSize = sizeof(header);
+    header.entryCount = (uint32_t)binaries_.size();
+    header.driverHash = driverHash_;
+    header.payloadChecksum = snapshotChecksum(payload.data(), payload.size());
+
+    // A missing cache only costs a compile next time, so failures are not fatal.
+    AtomicFileWriter writer;
+    if (!writer.open(path_.c_str()) || !writer.write(&header, sizeof(header)) ||
+        !writer.write(payload.data(), payload.size()) || !writer.commit()) {
+        std::cerr << "Failed to write shader cache " << path_ << "\n";
+    }
+}
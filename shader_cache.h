@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const char* const SHADER_CACHE_FILE = "aquarium_shaders.bin";
+
+// Cache file layout (host byte order; the binaries only suit this driver anyway):
+//   ShaderCacheHeader    32 bytes
+//   per program:         ShaderCacheEntry, then `size` bytes of binary
+const uint32_t SHADER_CACHE_MAGIC = 0x48535141; // "AQSH"
+const uint16_t SHADER_CACHE_VERSION = 1;
+
+struct ShaderCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t driverHash;        // over GL_VENDOR, GL_RENDERER and GL_VERSION
+    uint64_t payloadChecksum;
+};
+
+struct ShaderCacheEntry {
+    uint64_t sourceHash;        // over the vertex and fragment source
+    uint32_t format;            // as glGetProgramBinary reported it
+    uint32_t size;
+};
+
+// Links shader programs from the driver's own binaries saved by an earlier
+// run, so a warm start compiles nothing. Binaries are only valid for the
+// driver that produced them, so the whole file is keyed on the vendor,
+// renderer and version strings and ignored after a driver change; a binary
+// the driver still rejects is compiled again from source.
+//
+// Programs compiled from source are linked without waiting for the result.
+// Where KHR_parallel_shader_compile is available, the driver compiles them
+// on its own threads until something first uses one; flush() then checks
+// every program, reports errors and saves the new binaries.
+class ShaderCache {
+public:
+    // Reads the cache for the current context. Call once glExt is loaded.
+    void load(const char* path);
+    // Returns a program for the two sources, linked or still linking.
+    GLuint createProgram(const char* vertexSrc, const char* fragmentSrc);
+    // Waits for programs still compiling and writes the cache if it gained
+    // binaries. Call after the last program of startup is created.
+    void flush();
+
+    int cachedPrograms() const { return cachedPrograms_; }
+    int compiledPrograms() const { return compiledPrograms_; }
+
+private:
+    struct Binary {
+        GLenum format;
+        std::vector<uint8_t> data;
+    };
+    struct Pending {
+        GLuint program, vertex, fragment;
+        uint64_t sourceHash;
+    };
+
+    void finish(const Pending& pending);
+    void write();
+
+    std::string path_;
+    uint64_t driverHash_ = 0;
+    std::unordered_map<uint64_t, Binary> binaries_;
+    std::vector<Pending> pending_;
+    bool dirty_ = false;
+    int cachedPrograms_ = 0;
+    int compiledPrograms_ = 0;
+};
+
+extern ShaderCache shaderCache;
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "aquarium.h"
+#include "memory_budget.h"
+#include "profiler.h"
+#include "telemetry.h"
+
+// Global Variables
+std::vector<Fish> fishes;
+std::vector<Fish> fishesLeftOut;
+float oxygenLevel = 1.0f;
+float foodLevel = 1.0f;
+bool areFishesDying = false;
+
+uint64_t simulationTick = 0;
+
+Button feedButton = { 0.45f, -0.85f, 0.4f, 0.12f, "Feed Food" };
+Button oxygenButton = { -0.85f, -0.85f, 0.4f, 0.12f, "Give Oxygen" };
+
+// Simulation Step
+void stepSimulation(float dt, FishStats& stats) {
+    PROFILE_SCOPE("Simulation step");
+    {
+        PROFILE_SCOPE("Level update");
+        // Decrease levels
+        oxygenLevel -= dt * 0.02f;
+        foodLevel -= dt * 0.04f;
+
+        // Clamp levels to prevent negative values
+        if (oxygenLevel < 0.f) oxygenLevel = 0.f;
+        if (foodLevel < 0.f) foodLevel = 0.f;
+
+        // Centralized logic to check if fishes should be dying (based on oxygen or food)
+        if ((foodLevel <= 0.0f || oxygenLevel <= 0.0f) && !areFishesDying) {
+            areFishesDying = true;
+        }
+        else if ((foodLevel > 0.4f && oxygenLevel > 0.4f) && areFishesDying) {
+            areFishesDying = false;
+            for (auto& f : fishes) {
+                f.isDying = false;
+                f.dx = ((rand() % 200) / 100.f - 1.f) * 0.5f;
+                f.dy = ((rand() % 200) / 100.f - 1.f) * 0.3f;
+            }
+        }
+    }
+
+    {
+        PROFILE_SCOPE("Fish loop");
+        stats.reset();
+        for (auto& f : fishes) {
+            if (areFishesDying) {
+                f.isDying = true;
+            }
+            f.happiness -= dt * 0.02f * (1.f - foodLevel);
+            if (f.happiness > 1.f) f.happiness = 1.f;
+            if (f.happiness < 0.f) f.happiness = 0.f;
+            updateFish(f, dt);
+            stats.add(f);
+        }
+    }
+
+    simulationTick++;
+}
+
+// Input Handling
+void applyClick(float nx, float ny) {
+    if (checkButtonClick(feedButton, nx, ny)) {
+        // INSTANT REACTION: Add a large amount of food with one click
+        foodLevel += 0.8f;
+        if (foodLevel > 1.f) foodLevel = 1.f;
+
+        // INSTANT REACTION: Boost happiness for all fish
+        for (auto& f : fishes) {
+            f.happiness += 0.4f;
+            if (f.happiness > 1.f) f.happiness = 1.f;
+        }
+    }
+    else if (checkButtonClick(oxygenButton, nx, ny)) {
+        // INSTANT REACTION: Add a large amount of oxygen with one click
+        oxygenLevel += 0.8f;
+        if (oxygenLevel > 1.f) oxygenLevel = 1.f;
+    }
+}
+
+// Fish Logic
+void updateFish(Fish& f, float dt) {
+    if (f.isDying) {
+        f.dx = 0;
+        f.dy = -0.1f; // Sink slowly
+        f.x += f.dx * dt;
+        f.y += f.dy * dt;
+        if (f.y < -1.0f) f.y = -1.0f; // Stop at the bottom
+    }
+    else {
+        f.x += f.dx * dt;
+        f.y += f.dy * dt;
+
+        float halfSizeX = f.size / 2.0f;
+        float halfSizeY = halfSizeX * ((float)WINDOW_HEIGHT / (float)WINDOW_WIDTH);
+
+        if (f.y - halfSizeY < -1.f) {
+            f.y = -1.f + halfSizeY;
+            f.dy = -f.dy;
+        }
+        else if (f.y + halfSizeY > 1.f) {
+            f.y = 1.f - halfSizeY;
+            f.dy = -f.dy;
+        }
+
+        if (f.x - halfSizeX < -1.f) {
+            f.x = -1.f + halfSizeX;
+            f.dx = -f.dx;
+            f.facingRight = true;
+        }
+        else if (f.x + halfSizeX > 1.f) {
+            f.x = 1.f - halfSizeX;
+            f.dx = -f.dx;
+            f.facingRight = false;
+        }
+    }
+}
+
+// Fish the fish budget holds, or SIZE_MAX without one.
+static size_t fishBudgetCount() {
+    size_t budget = memoryUsage(MEMORY_FISH).budget;
+    return budget ? budget / sizeof(Fish) : SIZE_MAX;
+}
+
+size_t applyFishBudget() {
+    size_t limit = fishBudgetCount();
+    size_t dropped = 0;
+    fishesLeftOut.clear();
+    if (fishes.size() > limit) {
+        dropped = fishes.size() - limit;
+        fishesLeftOut.assign(fishes.begin() + limit, fishes.end());
+        fishes.resize(limit);
+        std::cerr << "The fish budget holds " << limit << " fish; left " << dropped << " out of the tank\n";
+    }
+    // Growing the array may have left room the budget does not allow.
+    if (fishes.capacity() > limit) fishes.shrink_to_fit();
+    memorySet(MEMORY_FISH, fishes.capacity() * sizeof(Fish));
+    return dropped;
+}
+
+void initFishes(int count) {
+    fishes.clear();
+    count = (int)std::min((size_t)count, fishBudgetCount());
+    for (int i = 0; i < count; i++) {
+        Fish f;
+        f.size = 0.15f + (rand() % 90) / 1000.f;
+        f.x = ((rand() % 2000) / 1000.f) - 1.f;
+        f.y = ((rand() % 2000) / 1000.f) - 1.f;
+
+        do {
+            f.dx = ((rand() % 200) / 100.f - 1.f) * 0.5f;
+            f.dy = ((rand() % 200) / 100.f - 1.f) * 0.3f;
+        } while (f.dx == 0.0f || f.dy == 0.0f);
+
+        f.facingRight = f.dx > 0;
+        f.happiness = 1.f;
+        f.species = (uint8_t)(i % FISH_SPECIES_COUNT);
+        f.swimPhase = (uint8_t)(rand() % FISH_SWIM_PHASES);
+        fishes.push_back(f);
+    }
+    applyFishBudget();
+}
+
+// UI Logic and Rendering
+bool checkButtonClick(const Button& btn, float mx, float my) {
+    return mx >= btn.x && mx <= btn.x + btn.width &&
+        my >= btn.y && my <= btn.y + btn.height;
+}
@@ -0,0 +1,156 @@
+#include "snapshot.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+#include "atomic_file.h"
+#include "mapped_file.h"
+
+// The fish block is the in-memory array, so its layout is part of the format.
+// Changing Fish requires bumping SNAPSHOT_VERSION.
+static_assert(std::is_trivially_copyable<Fish>::value, "Fish must be trivially copyable");
+static_assert(sizeof(Fish) == 32, "Fish layout changed, bump SNAPSHOT_VERSION");
+static_assert(offsetof(Fish, facingRight) == 20, "Fish layout changed, bump SNAPSHOT_VERSION");
+static_assert(offsetof(Fish, happiness) == 24, "Fish layout changed, bump SNAPSHOT_VERSION");
+static_assert(offsetof(Fish, isDying) == 28, "Fish layout changed, bump SNAPSHOT_VERSION");
+static_assert(offsetof(Fish, species) == 29, "Fish layout changed, bump SNAPSHOT_VERSION");
+static_assert(offsetof(Fish, swimPhase) == 30, "Fish layout changed, bump SNAPSHOT_VERSION");
+
+uint64_t snapshotChecksum(const void* data, size_t size) {
+    // Four independent multiply-xor lanes over 64-bit words, so a
+    // million-fish block hashes in a few milliseconds.
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const uint64_t prime = 0x100000001B3ull;
+    uint64_t lanes[4] = { 0xCBF29CE484222325ull, 0x84222325CBF29CE4ull, 0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full };
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t w;
+            std::memcpy(&w, p + i + l * 8, 8);
+            lanes[l] = (lanes[l] ^ w) * prime;
+        }
+    }
+    uint64_t h = lanes[0] ^ (lanes[1] << 1) ^ (lanes[2] << 2) ^ (lanes[3] << 3);
+    for (; i < size; i++) {
+        h = (h ^ p[i]) * prime;
+    }
+    return h ^ (uint64_t)size;
+}
+
+// Oxygen and food are fractions of full; a NaN reads as empty.
+static float clampLevel(float level) {
+    if (!(level > 0.f)) return 0.f;
+    return level > 1.f ? 1.f : level;
+}
+
+static uint32_t headerChecksum(SnapshotHeader header) {
+    header.headerChecksum = 0;
+    uint64_t h = snapshotChecksum(&header, sizeof(header));
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+SnapshotHeader makeSnapshotHeader(const Fish* fish, size_t count, const SnapshotLevels& levels) {
+    SnapshotHeader header = {};
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.fishStride = sizeof(Fish);
+    header.fishCount = count;
+    header.fishOffset = sizeof(SnapshotHeader);
+    header.oxygenLevel = levels.oxygen;
+    header.foodLevel = levels.food;
+    header.flags = levels.fishesDying ? (uint32_t)SNAPSHOT_FLAG_FISHES_DYING : 0u;
+    header.payloadChecksum = snapshotChecksum(fish, count * sizeof(Fish));
+    header.headerChecksum = headerChecksum(header);
+    return header;
+}
+
+bool saveSnapshot(const char* path, const Fish* fish, size_t count, const SnapshotLevels& levels) {
+    SnapshotHeader header = makeSnapshotHeader(fish, count, levels);
+    AtomicFileWriter file;
+    return file.open(path) &&
+        file.write(&header, sizeof(header)) &&
+        file.write(fish, count * sizeof(Fish)) &&
+        file.commit();
+}
+
+bool loadSnapshot(const char* path, std::vector<Fish>& out, SnapshotLevels& levels) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    return loadSnapshotFromMemory(file.data(), file.size(), path, out, levels);
+}
+
+bool loadSnapshotFromMemory(const unsigned char* data, size_t size, const char* path, std::vector<Fish>& out, SnapshotLevels& levels) {
+    if (size < sizeof(SnapshotHeader)) {
+        std::cerr << "Snapshot " << path << " is truncated\n";
+        return false;
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.magic != SNAPSHOT_MAGIC) {
+        std::cerr << "Snapshot " << path << " has a bad magic number\n";
+        return false;
+    }
+    if (header.byteOrder != SNAPSHOT_BYTE_ORDER) {
+        std::cerr << "Snapshot " << path << " was written with a different byte order\n";
+        return false;
+    }
+    if (header.version < 1 || header.version > SNAPSHOT_VERSION || header.headerSize != sizeof(SnapshotHeader) ||
+        header.fishStride != sizeof(Fish)) {
+        std::cerr << "Snapshot " << path << " has unsupported version " << header.version << "\n";
+        return false;
+    }
+    if (header.headerChecksum != headerChecksum(header)) {
+        std::cerr << "Snapshot " << path << " has a corrupt header\n";
+        return false;
+    }
+    uint64_t payloadSize = header.fishCount * sizeof(Fish);
+    if (header.fishOffset % alignof(Fish) != 0 || header.fishOffset > size ||
+        payloadSize / sizeof(Fish) != header.fishCount || payloadSize > size - header.fishOffset) {
+        std::cerr << "Snapshot " << path << " is truncated\n";
+        return false;
+    }
+    const Fish* src = reinterpret_cast<const Fish*>(data + header.fishOffset);
+    if (snapshotChecksum(src, (size_t)payloadSize) != header.payloadChecksum) {
+        std::cerr << "Snapshot " << path << " has a corrupt fish block\n";
+        return false;
+    }
+
+    out.assign(src, src + header.fishCount);
+    if (header.version < 2) {
+        for (Fish& f : out) f.species = 0;
+    }
+    if (header.version < 3) {
+        // Spread the old fish over the cycle so they do not swim in lockstep.
+        for (size_t i = 0; i < out.size(); i++) out[i].swimPhase = (uint8_t)(i * 37 % FISH_SWIM_PHASES);
+    }
+    levels.oxygen = clampLevel(header.oxygenLevel);
+    levels.food = clampLevel(header.foodLevel);
+    levels.fishesDying = (header.flags & SNAPSHOT_FLAG_FISHES_DYING) != 0;
+    return true;
+}
+
+// File I/O for State Saving
+void saveStatus(float oxygen, float food, const char* path) {
+    std::ofstream file(path);
+    if (file) {
+        file << oxygen << " " << food << "\n";
+    }
+}
+
+bool loadStatus(float& oxygen, float& food, const char* path) {
+    std::ifstream file(path);
+    if (file) {
+        file >> oxygen >> food;
+        oxygen = clampLevel(oxygen);
+        food = clampLevel(food);
+        return true;
+    }
+    return false;
+}
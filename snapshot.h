@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "aquarium.h"
+
+// Binary snapshot of the complete tank state.
+//
+// Layout (host byte order, version 3):
+//   SnapshotHeader       64 bytes
+//   Fish[fishCount]      starting at fishOffset, stored exactly as in memory
+//
+// The fish block is a raw copy of the in-memory Fish array, padding bytes
+// included, so that loading is a single copy out of the mapped file with no
+// per-field parsing. The format is therefore not portable: a file only loads
+// on a host with the same byte order (checked through byteOrder) and the
+// same Fish layout (checked through fishStride and the version).
+// Version 1 had no Fish::species and versions 1-2 no Fish::swimPhase; their
+// bytes were padding and are filled in on load.
+
+const uint32_t SNAPSHOT_MAGIC = 0x4E535141; // "AQSN"
+const uint16_t SNAPSHOT_VERSION = 3;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+const char* const SNAPSHOT_FILE = "aquarium_state.bin";
+
+enum SnapshotFlags : uint32_t {
+    SNAPSHOT_FLAG_FISHES_DYING = 1u << 0,
+};
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t byteOrder;      // SNAPSHOT_BYTE_ORDER as written by the host
+    uint32_t fishStride;     // sizeof(Fish) when written
+    uint64_t fishCount;
+    uint64_t fishOffset;     // byte offset of the fish block from file start
+    float oxygenLevel;
+    float foodLevel;
+    uint32_t flags;          // SnapshotFlags
+    uint32_t headerChecksum; // over this header with the field zeroed
+    uint64_t payloadChecksum;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader must stay 64 bytes");
+
+// Tank-wide values stored next to the fish block.
+struct SnapshotLevels {
+    float oxygen = 1.0f;
+    float food = 1.0f;
+    bool fishesDying = false;
+};
+
+// Fills in a complete header for the given state, including checksums.
+SnapshotHeader makeSnapshotHeader(const Fish* fish, size_t count, const SnapshotLevels& levels);
+
+// Writes through AtomicFileWriter, so an interrupted save keeps the old file.
+bool saveSnapshot(const char* path, const Fish* fish, size_t count, const SnapshotLevels& levels);
+
+// Maps the file and copies the fish block straight into 'out'. Leaves 'out'
+// and 'levels' untouched when the file is missing or fails validation.
+bool loadSnapshot(const char* path, std::vector<Fish>& out, SnapshotLevels& levels);
+// Same as loadSnapshot for a snapshot embedded in a larger buffer. 'data'
+// must be aligned for Fish; 'name' is only used in error messages.
+bool loadSnapshotFromMemory(const unsigned char* data, size_t size, const char* name, std::vector<Fish>& out, SnapshotLevels& levels);
+
+uint64_t snapshotChecksum(const void* data, size_t size);
@@ -0,0 +1,488 @@
+#include "software_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "profiler.h"
+#include "renderer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// The fish shader discards fragments below 0.1 alpha.
+static const int SOFT_ALPHA_CUTOFF = 26;
+
+static inline uint32_t packColor(int r, int g, int b) {
+    return (uint32_t)r | (uint32_t)g << 8 | (uint32_t)b << 16 | 0xff000000u;
+}
+
+// x * y / 255 for 8-bit x and y, rounded.
+static inline int mulDiv255(int x, int y) {
+    int p = x * y + 128;
+    return (p + (p >> 8)) >> 8;
+}
+
+bool SoftwareRenderer::init(int width, int height, int threads) {
+    shutdown();
+    width_ = width;
+    height_ = height;
+    pixels_.assign((size_t)width * height, 0);
+    tileCount_ = (height + SOFT_TILE_ROWS - 1) / SOFT_TILE_ROWS;
+    tileSprites_.assign(tileCount_, {});
+    waveColumns_.resize(width);
+    waveRows_.resize(height);
+
+    SpriteSheet sheets[FISH_SPECIES_COUNT];
+    for (int i = 0; i < FISH_SPECIES_COUNT; i++) {
+        sheets[i] = { FISH_SPECIES[i].sprite, FISH_SPECIES[i].sheetColumns, FISH_SPECIES[i].swimFrames };
+    }
+    SpriteAtlas atlas;
+    if (!atlas.loadTexels(sheets, FISH_SPECIES_COUNT, ATLAS_CACHE_FILE)) {
+        return false;
+    }
+    buildMips(atlas);
+
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    threads = std::min(std::max(threads, 1), SOFT_MAX_THREADS);
+    quit_ = false;
+    for (int i = 1; i < threads; i++) workers_.emplace_back(&SoftwareRenderer::workerLoop, this);
+    return true;
+}
+
+void SoftwareRenderer::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) worker.join();
+    workers_.clear();
+    pixels_.clear();
+    mips_.clear();
+    width_ = height_ = 0;
+    tileCount_ = 0;
+}
+
+// Premultiplies every atlas layer and box-filters it down to a chain of
+// SOFT_MIP_LEVELS levels. Premultiplied texels filter without the dark
+// fringes straight alpha gets from its transparent neighbours.
+void SoftwareRenderer::buildMips(const SpriteAtlas& atlas) {
+    chainBytes_ = 0;
+    for (int level = 0; level < SOFT_MIP_LEVELS; level++) {
+        int size = ATLAS_LAYER_SIZE >> level;
+        levelOffsets_[level] = chainBytes_;
+        chainBytes_ += (size_t)size * size * 4;
+    }
+    mips_.assign(chainBytes_ * atlas.layers(), 0);
+
+    const size_t layerBytes = (size_t)ATLAS_LAYER_SIZE * ATLAS_LAYER_SIZE * 4;
+    for (int layer = 0; layer < atlas.layers(); layer++) {
+        const uint8_t* src = atlas.texels() + layer * layerBytes;
+        uint8_t* chain = mips_.data() + layer * chainBytes_;
+        for (size_t i = 0; i < layerBytes; i += 4) {
+            int a = src[i + 3];
+            chain[i] = (uint8_t)mulDiv255(src[i], a);
+            chain[i + 1] = (uint8_t)mulDiv255(src[i + 1], a);
+            chain[i + 2] = (uint8_t)mulDiv255(src[i + 2], a);
+            chain[i + 3] = (uint8_t)a;
+        }
+        for (int level = 1; level < SOFT_MIP_LEVELS; level++) {
+            int size = ATLAS_LAYER_SIZE >> level;
+            const uint8_t* parent = chain + levelOffsets_[level - 1];
+            uint8_t* dst = chain + levelOffsets_[level];
+            size_t parentPitch = (size_t)size * 2 * 4;
+            for (int y = 0; y < size; y++) {
+                for (int x = 0; x < size; x++) {
+                    const uint8_t* p = parent + y * 2 * parentPitch + x * 2 * 4;
+                    for (int c = 0; c < 4; c++) {
+                        dst[((size_t)y * size + x) * 4 + c] =
+                            (uint8_t)((p[c] + p[4 + c] + p[parentPitch + c] + p[parentPitch + 4 + c] + 2) >> 2);
+                    }
+                }
+            }
+        }
+    }
+
+    // The u extent of each outline over the band of t one atlas row covers,
+    // so fish rows are only walked where the sprite can be visible.
+    for (int i = 0; i < FISH_SPECIES_COUNT; i++) {
+        animations_[i] = atlas.animation(i);
+        const SpriteOutline& outline = atlas.outline(i);
+        for (int row = 0; row < ATLAS_LAYER_SIZE; row++) {
+            float top = 1.0f - (float)row / ATLAS_LAYER_SIZE;
+            float bottom = 1.0f - (float)(row + 1) / ATLAS_LAYER_SIZE;
+            float lo = 1.0f, hi = 0.0f;
+            for (int v = 0; v < outline.vertexCount; v++) {
+                const float* a = outline.uv[v];
+                const float* b = outline.uv[(v + 1) % outline.vertexCount];
+                if (a[1] >= bottom && a[1] <= top) {
+                    lo = std::min(lo, a[0]);
+                    hi = std::max(hi, a[0]);
+                }
+                for (float t : { top, bottom }) {
+                    if ((a[1] - t) * (b[1] - t) > 0.0f || a[1] == b[1]) continue;
+                    float u = a[0] + (t - a[1]) / (b[1] - a[1]) * (b[0] - a[0]);
+                    lo = std::min(lo, u);
+                    hi = std::max(hi, u);
+                }
+            }
+            outlineSpans_[i][row][0] = lo;
+            outlineSpans_[i][row][1] = hi;
+        }
+    }
+}
+
+void SoftwareRenderer::render(const RenderScene& scene) {
+    {
+        PROFILE_SCOPE("Software setup");
+        // Same waves as the background shader: a column term and a row
+        // term, summed per pixel.
+        float aspect = (float)WINDOW_WIDTH / WINDOW_HEIGHT;
+        for (int x = 0; x < width_; x++) {
+            float ndc = (x + 0.5f) * 2.0f / width_ - 1.0f;
+            waveColumns_[x] = std::sin(ndc * aspect * 5.0f + scene.time * 0.5f) * 0.1f;
+        }
+        for (int y = 0; y < height_; y++) {
+            float ndc = (y + 0.5f) * 2.0f / height_ - 1.0f;
+            waveRows_[y] = std::sin(ndc * 3.0f + scene.time * 0.3f) * 0.05f;
+        }
+        baseColor_[0] = 0.0f;
+        baseColor_[1] = (0.3f + 0.7f * scene.oxygen) * 255.0f;
+        baseColor_[2] = (0.7f * scene.oxygen + 0.2f) * 255.0f;
+        const float wave[3] = { 0.0f, 0.4f * 255.0f, 0.8f * 255.0f };
+        for (int c = 0; c < 3; c++) waveColor_[c] = wave[c] - baseColor_[c];
+
+        setupFishes(scene);
+
+        // Same layout as Renderer::drawHud; the text goes over every bar.
+        rects_ = FrameVector<Rect>();
+        textVertices_ = FrameVector<float>();
+        float barHeight = 0.05f;
+        float barWidth = 0.5f;
+        float barX = -0.9f;
+        float foodY = 0.9f;
+        float oxygenY = foodY - barHeight - 0.05f;
+        addBar(barX, foodY, barWidth * scene.food, barHeight, 1.0f, 0.6f, 0.0f, barWidth);
+        addBar(barX, oxygenY, barWidth * scene.oxygen, barHeight, 0.0f, 0.8f, 0.8f, barWidth);
+        addBar(feedButton.x, feedButton.y, feedButton.width, feedButton.height, 1.0f, 0.6f, 0.0f, feedButton.width);
+        addBar(oxygenButton.x, oxygenButton.y, oxygenButton.width, oxygenButton.height, 0.0f, 0.8f, 0.8f, oxygenButton.width);
+        addText(30, (1.0f - (foodY + 1.0f) / 2.0f) * WINDOW_HEIGHT, "Food", 1.0f, 1.0f, 1.0f, 1.0f);
+        addText(30, (1.0f - (oxygenY + 1.0f) / 2.0f) * WINDOW_HEIGHT, "Oxygen", 1.0f, 1.0f, 1.0f, 1.0f);
+        for (const Button* button : { &feedButton, &oxygenButton }) {
+            addText((button->x + 1.0f) / 2.0f * WINDOW_WIDTH + 10,
+                (1.0f - (button->y + 1.0f) / 2.0f) * WINDOW_HEIGHT - 35,
+                button->label, 1.f, 1.f, 1.f, 1.5f);
+        }
+        if (scene.overlayText) {
+            addText(260, 20, scene.overlayText, 1.0f, 1.0f, 0.4f, 1.0f);
+        }
+    }
+
+    PROFILE_SCOPE("Software draw");
+    nextTile_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frame_++;
+        busyWorkers_ = (int)workers_.size();
+    }
+    wake_.notify_all();
+    drawTiles();
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this] { return busyWorkers_ == 0; });
+}
+
+void SoftwareRenderer::setupFishes(const RenderScene& scene) {
+    size_t previous = sprites_.size();
+    sprites_ = FrameVector<Sprite>();
+    sprites_.reserve(previous);
+    for (FrameVector<uint32_t>& tile : tileSprites_) tile = FrameVector<uint32_t>();
+
+    // Drawn in the GL renderer's order: the fish resting on the bottom,
+    // then the live ones grouped by species.
+    const std::vector<Fish>& fishes = *scene.fishes;
+    for (int resting = 1; resting >= 0; resting--) {
+        for (int species = 0; species < FISH_SPECIES_COUNT; species++) {
+            for (const Fish& f : fishes) {
+                int fishSpecies = f.species < FISH_SPECIES_COUNT ? f.species : 0;
+                if (fishSpecies != species || (f.isDying && f.y <= -1.0f) != (resting != 0)) continue;
+
+                Sprite sprite;
+                sprite.sizeX = f.size * 0.5f * width_;
+                sprite.sizeY = f.size * 0.5f * height_;
+                sprite.centerX = (f.x + 1.0f) * 0.5f * width_;
+                sprite.centerY = (f.y + 1.0f) * 0.5f * height_;
+                sprite.x0 = std::max(0, (int)std::ceil(sprite.centerX - sprite.sizeX * 0.5f - 0.5f));
+                sprite.x1 = std::min(width_, (int)std::ceil(sprite.centerX + sprite.sizeX * 0.5f - 0.5f));
+                sprite.y0 = std::max(0, (int)std::ceil(sprite.centerY - sprite.sizeY * 0.5f - 0.5f));
+                sprite.y1 = std::min(height_, (int)std::ceil(sprite.centerY + sprite.sizeY * 0.5f - 0.5f));
+                if (sprite.x0 >= sprite.x1 || sprite.y0 >= sprite.y1) continue;
+
+                // The vertex shader's frame pick; dying fish hold their frame.
+                const SpriteAnimation& animation = animations_[species];
+                float speed = f.isDying ? 0.0f : std::sqrt(f.dx * f.dx + f.dy * f.dy);
+                float rate = speed > 0.0f
+                    ? FISH_SPECIES[species].framesPerSecond * std::min(std::max(speed / FISH_CRUISE_SPEED, 0.25f), 2.0f)
+                    : 0.0f;
+                float phase = f.swimPhase * (1.0f / FISH_SWIM_PHASES);
+                int frame = (int)std::fmod(std::floor(scene.time * rate + phase * animation.frames), (float)animation.frames);
+                int layer = animation.firstLayer + std::min(std::max(frame, 0), animation.frames - 1);
+
+                // The level whose texels are closest to one per pixel.
+                float texelsPerPixel = std::max(ATLAS_LAYER_SIZE / sprite.sizeX, ATLAS_LAYER_SIZE / sprite.sizeY);
+                int level = texelsPerPixel > 1.0f ? (int)std::lround(std::log2(texelsPerPixel)) : 0;
+                level = std::min(level, SOFT_MIP_LEVELS - 1);
+                sprite.levelSize = ATLAS_LAYER_SIZE >> level;
+                sprite.texels = mips_.data() + layer * chainBytes_ + levelOffsets_[level];
+                sprite.species = species;
+                sprite.flip = f.facingRight ? 1.0f : -1.0f;
+                float tint = 1.0f - 0.7f * (1.0f - f.happiness);
+                sprite.tint = (uint16_t)std::min(std::max(std::lround(tint * 256.0f), 0L), 256L);
+
+                uint32_t index = (uint32_t)sprites_.size();
+                sprites_.push_back(sprite);
+                for (int tile = sprite.y0 / SOFT_TILE_ROWS; tile <= (sprite.y1 - 1) / SOFT_TILE_ROWS; tile++) {
+                    tileSprites_[tile].push_back(index);
+                }
+            }
+        }
+    }
+}
+
+// Takes a rectangle in bottom-up framebuffer pixels and keeps the pixels
+// whose centers it covers, like the GL rasterizer.
+void SoftwareRenderer::addRect(float x0, float y0, float x1, float y1, float r, float g, float b) {
+    Rect rect;
+    rect.x0 = std::max(0, (int)std::ceil(x0 - 0.5f));
+    rect.x1 = std::min(width_, (int)std::ceil(x1 - 0.5f));
+    rect.y0 = std::max(0, (int)std::ceil(y0 - 0.5f));
+    rect.y1 = std::min(height_, (int)std::ceil(y1 - 0.5f));
+    if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1) return;
+    rect.color = packColor((int)std::lround(r * 255.0f), (int)std::lround(g * 255.0f), (int)std::lround(b * 255.0f));
+    rects_.push_back(rect);
+}
+
+void SoftwareRenderer::addBar(float x, float y, float width, float height, float r, float g, float b, float maxWidth) {
+    auto px = [this](float ndc) { return (ndc + 1.0f) * 0.5f * width_; };
+    auto py = [this](float ndc) { return (ndc + 1.0f) * 0.5f * height_; };
+    addRect(px(x), py(y), px(x + maxWidth), py(y + height), 0.2f, 0.2f, 0.2f);
+    addRect(px(x), py(y), px(x + width), py(y + height), r, g, b);
+}
+
+// Text is laid out in window pixels, y down, like the GL text projection.
+void SoftwareRenderer::addText(float x, float y, const char* text, float r, float g, float b, float scale) {
+    int quads = layoutText(x, y, text, scale, textVertices_);
+    float sx = (float)width_ / WINDOW_WIDTH;
+    float sy = (float)height_ / WINDOW_HEIGHT;
+    for (int q = 0; q < quads; q++) {
+        const float* v = textVertices_.data() + q * 8;
+        float minX = std::min(std::min(v[0], v[2]), std::min(v[4], v[6]));
+        float maxX = std::max(std::max(v[0], v[2]), std::max(v[4], v[6]));
+        float minY = std::min(std::min(v[1], v[3]), std::min(v[5], v[7]));
+        float maxY = std::max(std::max(v[1], v[3]), std::max(v[5], v[7]));
+        addRect(minX * sx, height_ - maxY * sy, maxX * sx, height_ - minY * sy, r, g, b);
+    }
+}
+
+void SoftwareRenderer::workerLoop() {
+    PROFILE_THREAD_NAME("Software raster worker");
+    uint64_t seenFrame = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return quit_ || frame_ != seenFrame; });
+            if (quit_) return;
+            seenFrame = frame_;
+        }
+        drawTiles();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--busyWorkers_ == 0) finished_.notify_one();
+    }
+}
+
+void SoftwareRenderer::drawTiles() {
+    for (int tile; (tile = nextTile_.fetch_add(1)) < tileCount_;) drawTile(tile);
+}
+
+// Tiles are drawn front to back: the HUD first, then the fish from the
+// topmost down, each blended under what is already there, and the water
+// last beneath whatever is still uncovered. Once a pixel is opaque every
+// layer below skips it, so the overdraw of a crowded tank costs one alpha
+// test per pixel instead of a filtered sample and a blend.
+void SoftwareRenderer::drawTile(int tile) {
+    int y0 = tile * SOFT_TILE_ROWS;
+    int y1 = std::min(height_, y0 + SOFT_TILE_ROWS);
+    std::memset(pixels_.data() + (size_t)y0 * width_, 0, (size_t)(y1 - y0) * width_ * sizeof(uint32_t));
+    for (auto rect = rects_.rbegin(); rect != rects_.rend(); ++rect) drawRect(*rect, y0, y1);
+    const FrameVector<uint32_t>& sprites = tileSprites_[tile];
+    for (auto index = sprites.rbegin(); index != sprites.rend(); ++index) drawSprite(sprites_[*index], y0, y1);
+    drawBackground(y0, y1);
+}
+
+// Fills the uncovered part of each pixel with the water.
+void SoftwareRenderer::drawBackground(int y0, int y1) {
+    for (int y = y0; y < y1; y++) {
+        uint32_t* row = pixels_.data() + (size_t)y * width_;
+        float waveRow = waveRows_[y];
+        int x = 0;
+#ifdef SOFT_SSE2
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 rowWave = _mm_set1_ps(waveRow);
+        const __m128 baseG = _mm_set1_ps(baseColor_[1]), baseB = _mm_set1_ps(baseColor_[2]);
+        const __m128 waveG = _mm_set1_ps(waveColor_[1]), waveB = _mm_set1_ps(waveColor_[2]);
+        const __m128i opaque = _mm_set1_epi32((int)0xff000000);
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 4 <= width_; x += 4) {
+            __m128i front = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+            int opaqueMask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(front, opaque), opaque));
+            if (opaqueMask == 0xffff) continue;
+
+            __m128 w = _mm_and_ps(_mm_add_ps(_mm_loadu_ps(waveColumns_.data() + x), rowWave), absMask);
+            // Red is zero in both colors.
+            __m128i g = _mm_cvtps_epi32(_mm_add_ps(baseG, _mm_mul_ps(waveG, w)));
+            __m128i b = _mm_cvtps_epi32(_mm_add_ps(baseB, _mm_mul_ps(waveB, w)));
+            __m128i water = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(g, 8), _mm_slli_epi32(b, 16)), opaque);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(front, zero)) == 0xffff) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), water);
+                continue;
+            }
+            // front + water * (1 - front alpha), two pixels at a time.
+            __m128i halves[2];
+            for (int h = 0; h < 2; h++) {
+                __m128i f = h ? _mm_unpackhi_epi8(front, zero) : _mm_unpacklo_epi8(front, zero);
+                __m128i wv = h ? _mm_unpackhi_epi8(water, zero) : _mm_unpacklo_epi8(water, zero);
+                __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(f, 0xff), 0xff);
+                __m128i scaled = _mm_add_epi16(_mm_mullo_epi16(wv, _mm_sub_epi16(_mm_set1_epi16(255), alpha)), _mm_set1_epi16(128));
+                scaled = _mm_srli_epi16(_mm_add_epi16(scaled, _mm_srli_epi16(scaled, 8)), 8);
+                halves[h] = _mm_add_epi16(f, scaled);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_packus_epi16(halves[0], halves[1]));
+        }
+#endif
+        for (; x < width_; x++) {
+            uint8_t* out = reinterpret_cast<uint8_t*>(row + x);
+            int cover = 255 - out[3];
+            if (cover == 0) continue;
+            float w = std::fabs(waveColumns_[x] + waveRow);
+            int water[4] = { (int)std::lround(baseColor_[0] + waveColor_[0] * w),
+                (int)std::lround(baseColor_[1] + waveColor_[1] * w),
+                (int)std::lround(baseColor_[2] + waveColor_[2] * w), 255 };
+            for (int c = 0; c < 4; c++) out[c] = (uint8_t)std::min(out[c] + mulDiv255(water[c], cover), 255);
+        }
+    }
+}
+
+void SoftwareRenderer::drawSprite(const Sprite& sprite, int y0, int y1) {
+    const int size = sprite.levelSize;
+    const size_t pitch = (size_t)size * 4;
+    // Texel x at pixel px is s0 + px * ds, before the half-texel offset.
+    const float ds = sprite.flip * size / sprite.sizeX;
+    const float s0 = ((0.5f - sprite.centerX) * sprite.flip / sprite.sizeX + 0.5f) * size - 0.5f;
+    const float (*spans)[2] = outlineSpans_[sprite.species];
+
+    for (int y = std::max(y0, sprite.y0); y < std::min(y1, sprite.y1); y++) {
+        // t runs up from the sprite's bottom edge, as in the atlas upload.
+        float t = (y + 0.5f - sprite.centerY) / sprite.sizeY + 0.5f;
+        int atlasRow = std::min(std::max((int)((1.0f - t) * ATLAS_LAYER_SIZE), 0), ATLAS_LAYER_SIZE - 1);
+        float uLeft = spans[atlasRow][0], uRight = spans[atlasRow][1];
+        if (uLeft > uRight) continue;
+        float left = sprite.centerX + sprite.flip * (uLeft - 0.5f) * sprite.sizeX;
+        float right = sprite.centerX + sprite.flip * (uRight - 0.5f) * sprite.sizeX;
+        if (left > right) std::swap(left, right);
+        int x0 = std::max(sprite.x0, (int)std::ceil(left - 0.5f));
+        int x1 = std::min(sprite.x1, (int)std::ceil(right - 0.5f));
+        if (x0 >= x1) continue;
+
+        // Bilinear weights are 7-bit fixed point, clamped to the edge texels.
+        int ty = (int)std::floor(((1.0f - t) * size - 0.5f) * 128.0f);
+        int texelY = ty >> 7, fy = ty & 127;
+        if (texelY < 0) texelY = 0, fy = 0;
+        if (texelY >= size - 1) texelY = size - 2, fy = 128;
+        const uint8_t* row0 = sprite.texels + texelY * pitch;
+        const uint8_t* row1 = row0 + pitch;
+        uint8_t* dst = reinterpret_cast<uint8_t*>(pixels_.data() + (size_t)y * width_);
+
+#ifdef SOFT_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i fyv = _mm_set1_epi16((short)fy);
+        const __m128i tint = _mm_setr_epi16(256, (short)sprite.tint, (short)sprite.tint, 256, 0, 0, 0, 0);
+        const __m128i half = _mm_set1_epi16(128);
+#endif
+        for (int x = x0; x < x1; x++) {
+            int cover = 255 - dst[x * 4 + 3];
+            if (cover == 0) continue;
+            int tx = (int)((s0 + x * ds) * 128.0f + 65536.0f) - 65536;
+            int texelX = tx >> 7, fx = tx & 127;
+            if (texelX < 0) texelX = 0, fx = 0;
+            if (texelX >= size - 1) texelX = size - 2, fx = 128;
+#ifdef SOFT_SSE2
+            // Both texel pairs at once, 16 bits per channel: lerp the rows,
+            // then the upper texel of the result into the lower one.
+            __m128i top = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row0 + texelX * 4)), zero);
+            __m128i bottom = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row1 + texelX * 4)), zero);
+            __m128i v = _mm_add_epi16(top, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(bottom, top), fyv), 7));
+            __m128i next = _mm_unpackhi_epi64(v, v);
+            __m128i texel = _mm_add_epi16(v, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(next, v), _mm_set1_epi16((short)fx)), 7));
+            texel = _mm_srli_epi16(_mm_mullo_epi16(texel, tint), 8);
+            if (_mm_extract_epi16(texel, 3) < SOFT_ALPHA_CUTOFF) continue;
+            __m128i scaled = _mm_add_epi16(_mm_mullo_epi16(texel, _mm_set1_epi16((short)cover)), half);
+            scaled = _mm_srli_epi16(_mm_add_epi16(scaled, _mm_srli_epi16(scaled, 8)), 8);
+            __m128i front = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*reinterpret_cast<const int*>(dst + x * 4)), zero);
+            __m128i color = _mm_add_epi16(front, scaled);
+            *reinterpret_cast<int*>(dst + x * 4) = _mm_cvtsi128_si32(_mm_packus_epi16(color, color));
+#else
+            const uint8_t* a = row0 + texelX * 4;
+            const uint8_t* b = row1 + texelX * 4;
+            int texel[4];
+            for (int c = 0; c < 4; c++) {
+                int left = a[c] + (((b[c] - a[c]) * fy) >> 7);
+                int right = a[4 + c] + (((b[4 + c] - a[4 + c]) * fy) >> 7);
+                texel[c] = left + (((right - left) * fx) >> 7);
+            }
+            texel[1] = texel[1] * sprite.tint >> 8;
+            texel[2] = texel[2] * sprite.tint >> 8;
+            if (texel[3] < SOFT_ALPHA_CUTOFF) continue;
+            uint8_t* out = dst + x * 4;
+            for (int c = 0; c < 4; c++) out[c] = (uint8_t)std::min(out[c] + mulDiv255(texel[c], cover), 255);
+#endif
+        }
+    }
+}
+
+// HUD rectangles are opaque, so under everything drawn so far they only
+// fill what is still empty.
+void SoftwareRenderer::drawRect(const Rect& rect, int y0, int y1) {
+    for (int y = std::max(y0, rect.y0); y < std::min(y1, rect.y1); y++) {
+        uint32_t* row = pixels_.data() + (size_t)y * width_;
+        for (int x = rect.x0; x < rect.x1; x++) {
+            if (row[x] == 0) row[x] = rect.color;
+        }
+    }
+}
+
+// Presentation
+
+bool SoftwarePresenter::init(GLADloadproc load) {
+    viewport_ = (ViewportProc)load("glViewport");
+    rasterPos2f_ = (RasterPos2fProc)load("glRasterPos2f");
+    pixelZoom_ = (PixelZoomProc)load("glPixelZoom");
+    drawPixels_ = (DrawPixelsProc)load("glDrawPixels");
+    if (!viewport_ || !rasterPos2f_ || !pixelZoom_ || !drawPixels_) {
+        std::cerr << "The OpenGL context has no glDrawPixels to present software frames with\n";
+        return false;
+    }
+    return true;
+}
+
+void SoftwarePresenter::present(const SoftwareRenderer& renderer, int framebufferWidth, int framebufferHeight) {
+    PROFILE_SCOPE("Software present");
+    // Legacy contexts start with identity matrices, so (-1, -1) is the
+    // bottom-left corner and the bottom-up rows go straight in.
+    viewport_(0, 0, framebufferWidth, framebufferHeight);
+    rasterPos2f_(-1.0f, -1.0f);
+    pixelZoom_((float)framebufferWidth / renderer.width(), (float)framebufferHeight / renderer.height());
+    drawPixels_(renderer.width(), renderer.height(), GL_RGBA, GL_UNSIGNED_BYTE, renderer.pixels());
+}
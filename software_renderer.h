@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "aquarium.h"
+#include "frame_arena.h"
+#include "sprite_atlas.h"
+
+struct RenderScene;
+
+const int SOFT_TILE_ROWS = 16;      // framebuffer rows per tile, the unit of work of a thread
+const int SOFT_MIP_LEVELS = 7;      // ATLAS_LAYER_SIZE down to 4 texels per side
+const int SOFT_MAX_THREADS = 16;
+
+// Draws the same passes as Renderer on the CPU, for machines whose OpenGL
+// driver is missing or older than 3.3: the wave background, the tinted and
+// flipped fish sprites blended over it, and the bars and text of the HUD.
+//
+// The framebuffer is split into bands of SOFT_TILE_ROWS rows. Each frame the
+// fish are set up once and binned into the bands they touch, then worker
+// threads take bands off a shared counter and draw every pass into them, so
+// no two threads ever write the same pixel. Fish sample the sprite atlas
+// bilinearly from a premultiplied mip level picked by their on-screen size,
+// and only across the span of their traced outline on each row; spans are
+// filled and blended with SSE2 where available. The water overlay is left
+// out: sampling it would cost more per pixel than the water below.
+class SoftwareRenderer {
+public:
+    ~SoftwareRenderer() { shutdown(); }
+
+    // `threads` counts the calling thread; 0 uses every hardware thread.
+    bool init(int width, int height, int threads = 0);
+    void shutdown();
+
+    void render(const RenderScene& scene);
+
+    // Bottom-up RGBA8 rows, as glReadPixels would return them.
+    const uint8_t* pixels() const { return reinterpret_cast<const uint8_t*>(pixels_.data()); }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int threads() const { return (int)workers_.size() + 1; }
+
+private:
+    // One fish as set up for the frame.
+    struct Sprite {
+        const uint8_t* texels;  // premultiplied mip level of its swim frame, top row first
+        int levelSize;
+        int species;
+        int x0, x1, y0, y1;     // covered pixels, end exclusive
+        float flip;
+        float centerX, centerY;  // in pixels
+        float sizeX, sizeY;
+        uint16_t tint;          // green and blue factor, 256 = untinted
+    };
+    // A solid HUD rectangle in pixels, end exclusive.
+    struct Rect {
+        int x0, y0, x1, y1;
+        uint32_t color;
+    };
+
+    void buildMips(const SpriteAtlas& atlas);
+    void setupFishes(const RenderScene& scene);
+    void addRect(float x0, float y0, float x1, float y1, float r, float g, float b);
+    void addBar(float x, float y, float width, float height, float r, float g, float b, float maxWidth);
+    void addText(float x, float y, const char* text, float r, float g, float b, float scale);
+
+    void workerLoop();
+    void drawTiles();
+    void drawTile(int tile);
+    void drawBackground(int y0, int y1);
+    void drawSprite(const Sprite& sprite, int y0, int y1);
+    void drawRect(const Rect& rect, int y0, int y1);
+
+    int width_ = 0, height_ = 0;
+    int tileCount_ = 0;
+    std::vector<uint32_t> pixels_;
+
+    // Mip chains of every atlas layer, level after level, layer after layer.
+    std::vector<uint8_t> mips_;
+    size_t levelOffsets_[SOFT_MIP_LEVELS] = {};
+    size_t chainBytes_ = 0;
+    SpriteAnimation animations_[FISH_SPECIES_COUNT] = {};
+    // Per species and atlas row, the u range inside the traced outline.
+    float outlineSpans_[FISH_SPECIES_COUNT][ATLAS_LAYER_SIZE][2] = {};
+
+    // Frame state, written before the workers start and only read by them.
+    std::vector<float> waveColumns_;
+    std::vector<float> waveRows_;
+    float baseColor_[3] = {}, waveColor_[3] = {};
+    // Rebuilt each frame in the frame arena of the thread calling render().
+    FrameVector<Sprite> sprites_;
+    std::vector<FrameVector<uint32_t>> tileSprites_;
+    FrameVector<Rect> rects_;
+    FrameVector<float> textVertices_;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;      // workers: a frame was started or quit set
+    std::condition_variable finished_;  // render(): the last worker is done
+    uint64_t frame_ = 0;
+    int busyWorkers_ = 0;
+    bool quit_ = false;
+    std::atomic<int> nextTile_{ 0 };
+};
+
+// Shows software frames in the current GLFW window through whatever OpenGL
+// the driver offers. glDrawPixels has been core since 1.0, so the GDI
+// renderer or any pre-3.3 context is enough. The entry points are looked up
+// here rather than through glad, which only loads complete 3.3 contexts.
+class SoftwarePresenter {
+public:
+    bool init(GLADloadproc load);
+    // Stretches the frame over a framebuffer of the given size.
+    void present(const SoftwareRenderer& renderer, int framebufferWidth, int framebufferHeight);
+
+private:
+    typedef void (APIENTRYP ViewportProc)(GLint x, GLint y, GLsizei width, GLsizei height);
+    typedef void (APIENTRYP RasterPos2fProc)(GLfloat x, GLfloat y);
+    typedef void (APIENTRYP PixelZoomProc)(GLfloat xfactor, GLfloat yfactor);
+    typedef void (APIENTRYP DrawPixelsProc)(GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+
+    ViewportProc viewport_ = nullptr;
+    RasterPos2fProc rasterPos2f_ = nullptr;
+    PixelZoomProc pixelZoom_ = nullptr;
+    DrawPixelsProc drawPixels_ = nullptr;
+};
@@ -0,0 +1,463 @@
+#include "sprite_atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "asset_pack.h"
+#include "atomic_file.h"
+#include "memory_budget.h"
+#include "profiler.h"
+#include "snapshot.h"
+
+// stb_image allocates through these, so the decode scratch counts every
+// buffer a decoder holds (a progressive JPEG keeps coefficients for each
+// component at full size), not only the image it returns. Each block
+// carries its size ahead of it for the free.
+static const size_t STBI_SIZE_PREFIX = alignof(std::max_align_t);
+
+static void* stbiMalloc(size_t size) {
+    uint8_t* block = static_cast<uint8_t*>(std::malloc(size + STBI_SIZE_PREFIX));
+    if (!block) return nullptr;
+    std::memcpy(block, &size, sizeof(size));
+    memoryAllocated(MEMORY_DECODE_SCRATCH, size);
+    return block + STBI_SIZE_PREFIX;
+}
+
+static void* stbiRealloc(void* p, size_t size) {
+    if (!p) return stbiMalloc(size);
+    uint8_t* block = static_cast<uint8_t*>(p) - STBI_SIZE_PREFIX;
+    size_t oldSize;
+    std::memcpy(&oldSize, block, sizeof(oldSize));
+    block = static_cast<uint8_t*>(std::realloc(block, size + STBI_SIZE_PREFIX));
+    if (!block) return nullptr;
+    std::memcpy(block, &size, sizeof(size));
+    memoryFreed(MEMORY_DECODE_SCRATCH, oldSize);
+    memoryAllocated(MEMORY_DECODE_SCRATCH, size);
+    return block + STBI_SIZE_PREFIX;
+}
+
+static void stbiFree(void* p) {
+    if (!p) return;
+    uint8_t* block = static_cast<uint8_t*>(p) - STBI_SIZE_PREFIX;
+    size_t size;
+    std::memcpy(&size, block, sizeof(size));
+    memoryFreed(MEMORY_DECODE_SCRATCH, size);
+    std::free(block);
+}
+
+#define STBI_MALLOC(size) stbiMalloc(size)
+#define STBI_REALLOC(p, size) stbiRealloc(p, size)
+#define STBI_FREE(p) stbiFree(p)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+static_assert(sizeof(AtlasCacheHeader) == 32, "AtlasCacheHeader must stay 32 bytes");
+static_assert(sizeof(SpriteOutline) == 4 + ATLAS_OUTLINE_VERTICES * 8, "SpriteOutline is cached as is");
+
+static const size_t ATLAS_LAYER_BYTES = (size_t)ATLAS_LAYER_SIZE * ATLAS_LAYER_SIZE * 4;
+
+// Swim cycle bend: tail sway in layer heights, and wavelengths along the body.
+static const float SWIM_AMPLITUDE = 0.05f;
+static const float SWIM_WAVELENGTHS = 0.75f;
+
+static int sheetFrames(const SpriteSheet& sheet) {
+    return sheet.swimFrames > 0 ? sheet.swimFrames : sheet.columns;
+}
+
+// Hashes the encoded source files, which is far cheaper than decoding them.
+static bool hashSources(const SpriteSheet* sheets, int count, uint64_t& hash) {
+    hash = 0xcbf29ce484222325ull;
+    for (int i = 0; i < count; i++) {
+        MappedFile file;
+        if (!file.open(sheets[i].path)) {
+            std::cerr << "Failed to load " << sheets[i].path << "\n";
+            return false;
+        }
+        hash = (hash ^ snapshotChecksum(file.data(), file.size())) * 0x100000001b3ull;
+        hash = (hash ^ file.size()) * 0x100000001b3ull;
+        hash = (hash ^ (uint64_t)sheets[i].columns << 32 ^ (uint64_t)sheets[i].swimFrames) * 0x100000001b3ull;
+    }
+    return true;
+}
+
+// Box-filters a straight-alpha RGBA image down (or up) to one layer of
+// `size` texels a side. Color is weighted by alpha so transparent texels do
+// not darken the sprite's edges. `pitch` is the source row length in texels,
+// so a sheet column can be passed.
+static void resampleToLayer(const uint8_t* src, int width, int height, int pitch, uint8_t* dst,
+    int size = ATLAS_LAYER_SIZE) {
+    for (int y = 0; y < size; y++) {
+        int y0 = y * height / size;
+        int y1 = (y + 1) * height / size;
+        if (y1 <= y0) y1 = y0 + 1;
+        for (int x = 0; x < size; x++) {
+            int x0 = x * width / size;
+            int x1 = (x + 1) * width / size;
+            if (x1 <= x0) x1 = x0 + 1;
+
+            uint64_t r = 0, g = 0, b = 0, a = 0;
+            for (int sy = y0; sy < y1; sy++) {
+                const uint8_t* p = src + ((size_t)sy * pitch + x0) * 4;
+                for (int sx = x0; sx < x1; sx++, p += 4) {
+                    r += p[0] * p[3];
+                    g += p[1] * p[3];
+                    b += p[2] * p[3];
+                    a += p[3];
+                }
+            }
+            uint8_t* out = dst + ((size_t)y * size + x) * 4;
+            uint64_t texels = (uint64_t)(x1 - x0) * (y1 - y0);
+            out[0] = a ? (uint8_t)((r + a / 2) / a) : 0;
+            out[1] = a ? (uint8_t)((g + a / 2) / a) : 0;
+            out[2] = a ? (uint8_t)((b + a / 2) / a) : 0;
+            out[3] = (uint8_t)((a + texels / 2) / texels);
+        }
+    }
+}
+
+// Bends a layer into one frame of a swim cycle. Sprites face right, so the
+// head at the right edge stays put and a wave travels towards the tail,
+// swaying it by up to SWIM_AMPLITUDE of the layer height.
+static void bendSwimFrame(const uint8_t* src, int frame, int frames, uint8_t* dst) {
+    const float pi = 3.14159265f;
+    float cycle = 2.0f * pi * frame / frames;
+    for (int x = 0; x < ATLAS_LAYER_SIZE; x++) {
+        float tail = 1.0f - (x + 0.5f) / ATLAS_LAYER_SIZE;
+        float shift = SWIM_AMPLITUDE * ATLAS_LAYER_SIZE * tail * tail *
+            std::sin(cycle - 2.0f * pi * SWIM_WAVELENGTHS * tail);
+        int whole = (int)std::floor(shift);
+        float fraction = shift - whole;
+        for (int y = 0; y < ATLAS_LAYER_SIZE; y++) {
+            // Linear blend of the two source rows the shifted texel straddles.
+            int sy0 = y - whole - 1, sy1 = y - whole;
+            uint8_t* out = dst + ((size_t)y * ATLAS_LAYER_SIZE + x) * 4;
+            const uint8_t* p0 = sy0 >= 0 && sy0 < ATLAS_LAYER_SIZE ? src + ((size_t)sy0 * ATLAS_LAYER_SIZE + x) * 4 : nullptr;
+            const uint8_t* p1 = sy1 >= 0 && sy1 < ATLAS_LAYER_SIZE ? src + ((size_t)sy1 * ATLAS_LAYER_SIZE + x) * 4 : nullptr;
+            float w0 = p0 ? fraction * p0[3] : 0.0f;
+            float w1 = p1 ? (1.0f - fraction) * p1[3] : 0.0f;
+            float a = w0 + w1;
+            for (int c = 0; c < 3; c++) {
+                float v = a > 0.0f ? ((p0 ? w0 * p0[c] : 0.0f) + (p1 ? w1 * p1[c] : 0.0f)) / a : 0.0f;
+                out[c] = (uint8_t)(v + 0.5f);
+            }
+            out[3] = (uint8_t)(a + 0.5f);
+        }
+    }
+}
+
+struct OutlinePoint {
+    float x, y;
+};
+
+static float cross(const OutlinePoint& o, const OutlinePoint& a, const OutlinePoint& b) {
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+// Andrew's monotone chain; returns the hull counter-clockwise.
+static std::vector<OutlinePoint> convexHull(std::vector<OutlinePoint> points) {
+    std::sort(points.begin(), points.end(), [](const OutlinePoint& a, const OutlinePoint& b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    std::vector<OutlinePoint> hull(points.size() * 2);
+    size_t k = 0;
+    for (size_t i = 0; i < points.size(); i++) {
+        while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+    for (size_t i = points.size() - 1, lower = k + 1; i-- > 0;) {
+        while (k >= lower && cross(hull[k - 2], hull[k - 1], points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+    hull.resize(k > 1 ? k - 1 : k);
+    return hull;
+}
+
+// Drops the edge whose neighbours, extended until they meet, add the least
+// area, and repeats until the polygon is small enough. The result still
+// contains the hull, so no visible texel is cut off. Corners that would
+// leave the unit square are not allowed.
+static void reduceHull(std::vector<OutlinePoint>& hull, int maxVertices) {
+    while ((int)hull.size() > maxVertices) {
+        size_t n = hull.size();
+        size_t best = n;
+        float bestArea = 0.0f;
+        OutlinePoint bestCorner = {};
+        for (size_t i = 0; i < n; i++) {
+            const OutlinePoint& a = hull[(i + n - 1) % n];
+            const OutlinePoint& b = hull[i];
+            const OutlinePoint& c = hull[(i + 1) % n];
+            const OutlinePoint& d = hull[(i + 2) % n];
+            // Intersect line a-b with line c-d.
+            float rx = b.x - a.x, ry = b.y - a.y;
+            float sx = d.x - c.x, sy = d.y - c.y;
+            float denom = rx * sy - ry * sx;
+            if (denom <= 1e-9f) continue;   // parallel or meeting behind the edge
+            float t = ((c.x - a.x) * sy - (c.y - a.y) * sx) / denom;
+            if (t < 1.0f) continue;
+            OutlinePoint corner = { a.x + t * rx, a.y + t * ry };
+            if (corner.x < -1e-4f || corner.x > 1.0001f || corner.y < -1e-4f || corner.y > 1.0001f) continue;
+            float area = 0.5f * std::fabs(cross(b, corner, c));
+            if (best == n || area < bestArea) {
+                best = i;
+                bestArea = area;
+                bestCorner = corner;
+            }
+        }
+        if (best == n) break;
+        hull[best] = bestCorner;
+        hull.erase(hull.begin() + (best + 1) % n);
+    }
+}
+
+// Traces the union of the visible texels of `frames` consecutive layers.
+// Each row contributes the outer corners of its leftmost and rightmost
+// visible texel, grown by one texel so bilinear filtering at the border
+// stays inside. Texel rows are top-down; the outline's v runs bottom-up.
+static SpriteOutline traceOutline(const uint8_t* layers, int frames) {
+    const float texel = 1.0f / ATLAS_LAYER_SIZE;
+    std::vector<OutlinePoint> points;
+    for (int y = 0; y < ATLAS_LAYER_SIZE; y++) {
+        int minX = ATLAS_LAYER_SIZE, maxX = -1;
+        for (int frame = 0; frame < frames; frame++) {
+            const uint8_t* row = layers + frame * ATLAS_LAYER_BYTES + (size_t)y * ATLAS_LAYER_SIZE * 4;
+            for (int x = 0; x < ATLAS_LAYER_SIZE; x++) {
+                if (row[x * 4 + 3] >= ATLAS_OUTLINE_ALPHA) {
+                    minX = std::min(minX, x);
+                    maxX = std::max(maxX, x);
+                }
+            }
+        }
+        if (maxX < 0) continue;
+        float left = std::max(0.0f, (minX - 1) * texel);
+        float right = std::min(1.0f, (maxX + 2) * texel);
+        float top = std::min(1.0f, 1.0f - (y - 1) * texel);
+        float bottom = std::max(0.0f, 1.0f - (y + 2) * texel);
+        points.push_back({ left, top });
+        points.push_back({ left, bottom });
+        points.push_back({ right, top });
+        points.push_back({ right, bottom });
+    }
+
+    SpriteOutline outline = {};
+    std::vector<OutlinePoint> hull;
+    if (!points.empty()) {
+        hull = convexHull(points);
+        reduceHull(hull, ATLAS_OUTLINE_VERTICES);
+    }
+    if (hull.size() < 3 || (int)hull.size() > ATLAS_OUTLINE_VERTICES) {
+        // Nothing visible, or no way to get under the vertex budget: the quad.
+        hull = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+    }
+    outline.vertexCount = (int32_t)hull.size();
+    for (size_t i = 0; i < hull.size(); i++) {
+        outline.uv[i][0] = hull[i].x;
+        outline.uv[i][1] = hull[i].y;
+    }
+    return outline;
+}
+
+bool SpriteAtlas::load(const SpriteSheet* sheets, int count, const char* cachePath) {
+    if (!loadTexels(sheets, count, cachePath)) return false;
+    upload();
+    return true;
+}
+
+bool SpriteAtlas::loadTexels(const SpriteSheet* sheets, int count, const char* cachePath) {
+    PROFILE_SCOPE("Sprite atlas load");
+    destroy();
+    int layers = 0;
+    for (int i = 0; i < count; i++) {
+        if (sheets[i].columns <= 0 || (sheets[i].swimFrames > 0 && sheets[i].columns != 1)) {
+            std::cerr << "Sprite sheet " << sheets[i].path << " needs one column to bend into swim frames\n";
+            return false;
+        }
+        animations_.push_back({ layers, sheetFrames(sheets[i]) });
+        layers += sheetFrames(sheets[i]);
+    }
+    if (layers <= 0 || layers > ATLAS_MAX_LAYERS) {
+        std::cerr << "Sprite atlas supports 1 to " << ATLAS_MAX_LAYERS << " frames, got " << layers << "\n";
+        return false;
+    }
+    layers_ = layers;
+    if (readPack()) return true;
+    if (!hashSources(sheets, count, sourceHash_)) return false;
+
+    if (!readCache(cachePath, sourceHash_)) {
+        if (!build(sheets, count)) return false;
+        writeCache(cachePath);
+    }
+    return true;
+}
+
+void SpriteAtlas::destroy() {
+    if (texture_) {
+        glDeleteTextures(1, &texture_);
+        memoryFreed(MEMORY_GPU_TEXTURES, bytes_);
+    }
+    texture_ = 0;
+    layers_ = 0;
+    bytes_ = 0;
+    sourceHash_ = 0;
+    texels_ = nullptr;
+    builtTexels_.clear();
+    cacheFile_.close();
+    animations_.clear();
+    outlines_.clear();
+}
+
+bool SpriteAtlas::readPack() {
+    if (!assetPack.isOpen()) return false;
+    AssetView packed = assetPack.find(ASSET_SPRITE_ATLAS);
+    if (!packed.data) return false;
+    if (!decode(packed.data, packed.size, 0, true)) {
+        std::cerr << "The asset pack's sprite atlas does not match these species, loading sources\n";
+        return false;
+    }
+    return true;
+}
+
+bool SpriteAtlas::readCache(const char* cachePath, uint64_t sourceHash) {
+    if (!cacheFile_.open(cachePath)) return false;
+    if (!decode(cacheFile_.data(), cacheFile_.size(), sourceHash, false)) {
+        cacheFile_.close();
+        return false;
+    }
+    return true;
+}
+
+bool SpriteAtlas::decode(const uint8_t* data, size_t size, uint64_t sourceHash, bool packed) {
+    AtlasCacheHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+
+    size_t texelBytes = (size_t)layers_ * ATLAS_LAYER_BYTES;
+    size_t payloadSize = texelBytes + animations_.size() * sizeof(SpriteOutline);
+    if (header.magic != ATLAS_CACHE_MAGIC || header.version != ATLAS_CACHE_VERSION ||
+        header.headerSize != sizeof(header) || header.layerSize != (uint32_t)ATLAS_LAYER_SIZE ||
+        header.layerCount != (uint32_t)layers_ || (!packed && header.sourceHash != sourceHash) ||
+        size != sizeof(header) + payloadSize) {
+        return false;
+    }
+    const uint8_t* payload = data + sizeof(header);
+    if (!packed && snapshotChecksum(payload, payloadSize) != header.payloadChecksum) {
+        std::cerr << "Sprite atlas cache is corrupt, rebuilding\n";
+        return false;
+    }
+    sourceHash_ = header.sourceHash;
+    texels_ = payload;
+    outlines_.resize(animations_.size());
+    std::memcpy(outlines_.data(), payload + texelBytes, outlines_.size() * sizeof(SpriteOutline));
+    return true;
+}
+
+bool SpriteAtlas::build(const SpriteSheet* sheets, int count) {
+    PROFILE_SCOPE("Sprite atlas build");
+    builtTexels_.resize((size_t)layers_ * ATLAS_LAYER_BYTES);
+    texels_ = builtTexels_.data();
+    for (int i = 0; i < count; i++) {
+        const SpriteSheet& sheet = sheets[i];
+        int width, height, channels;
+        unsigned char* data = stbi_load(sheet.path, &width, &height, &channels, 4);
+        if (!data) {
+            std::cerr << "Failed to load " << sheet.path << "\n";
+            return false;
+        }
+        uint8_t* first = builtTexels_.data() + animations_[i].firstLayer * ATLAS_LAYER_BYTES;
+        if (sheet.swimFrames > 0) {
+            std::vector<uint8_t> still(ATLAS_LAYER_BYTES);
+            resampleToLayer(data, width, height, width, still.data());
+            for (int frame = 0; frame < sheet.swimFrames; frame++) {
+                bendSwimFrame(still.data(), frame, sheet.swimFrames, first + frame * ATLAS_LAYER_BYTES);
+            }
+        }
+        else {
+            int columnWidth = width / sheet.columns;
+            for (int column = 0; column < sheet.columns; column++) {
+                resampleToLayer(data + (size_t)column * columnWidth * 4, columnWidth, height, width,
+                    first + column * ATLAS_LAYER_BYTES);
+            }
+        }
+        stbi_image_free(data);
+        outlines_.push_back(traceOutline(first, animations_[i].frames));
+    }
+    return true;
+}
+
+void SpriteAtlas::encode(std::vector<uint8_t>& out) const {
+    AtlasCacheHeader header = {};
+    header.magic = ATLAS_CACHE_MAGIC;
+    header.version = ATLAS_CACHE_VERSION;
+    header.headerSize = sizeof(header);
+    header.layerSize = ATLAS_LAYER_SIZE;
+    header.layerCount = (uint32_t)layers_;
+    header.sourceHash = sourceHash_;
+    size_t texelBytes = (size_t)layers_ * ATLAS_LAYER_BYTES;
+    const uint8_t* outlines = reinterpret_cast<const uint8_t*>(outlines_.data());
+    out.resize(sizeof(header));
+    out.insert(out.end(), texels_, texels_ + texelBytes);
+    out.insert(out.end(), outlines, outlines + outlines_.size() * sizeof(SpriteOutline));
+    header.payloadChecksum = snapshotChecksum(out.data() + sizeof(header), out.size() - sizeof(header));
+    std::memcpy(out.data(), &header, sizeof(header));
+}
+
+void SpriteAtlas::writeCache(const char* cachePath) {
+    std::vector<uint8_t> bytes;
+    encode(bytes);
+
+    // A missing cache only costs a rebuild next time, so failures are not fatal.
+    AtomicFileWriter writer;
+    if (!writer.open(cachePath) || !writer.write(bytes.data(), bytes.size()) || !writer.commit()) {
+        std::cerr << "Failed to write sprite atlas cache " << cachePath << "\n";
+    }
+}
+
+void SpriteAtlas::upload(size_t reservedTextureBytes) {
+    // Mips add a third.
+    size_t fullBytes = (size_t)layers_ * ATLAS_LAYER_BYTES * 4 / 3;
+    int reduction = textureReduction(fullBytes, ATLAS_MAX_REDUCTION, reservedTextureBytes);
+    int size = ATLAS_LAYER_SIZE >> reduction;
+
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_);
+    // Rows are stored top-down; flip them so t = 0 is the bottom, as stb's
+    // flipped loads used to give.
+    std::vector<uint8_t> flipped((size_t)layers_ * ATLAS_LAYER_BYTES);
+    memoryAllocated(MEMORY_DECODE_SCRATCH, flipped.size());
+    size_t rowBytes = (size_t)ATLAS_LAYER_SIZE * 4;
+    for (int layer = 0; layer < layers_; layer++) {
+        const uint8_t* src = texels_ + layer * ATLAS_LAYER_BYTES;
+        uint8_t* dst = flipped.data() + layer * ATLAS_LAYER_BYTES;
+        for (int y = 0; y < ATLAS_LAYER_SIZE; y++) {
+            std::memcpy(dst + y * rowBytes, src + (ATLAS_LAYER_SIZE - 1 - y) * rowBytes, rowBytes);
+        }
+    }
+    // Halved a level at a time with the filter the layers were built with.
+    for (int from = ATLAS_LAYER_SIZE; from > size; from /= 2) {
+        size_t fromBytes = (size_t)from * from * 4, toBytes = fromBytes / 4;
+        std::vector<uint8_t> halved(layers_ * toBytes);
+        memoryAllocated(MEMORY_DECODE_SCRATCH, halved.size());
+        for (int layer = 0; layer < layers_; layer++) {
+            resampleToLayer(flipped.data() + layer * fromBytes, from, from, from, halved.data() + layer * toBytes, from / 2);
+        }
+        memoryFreed(MEMORY_DECODE_SCRATCH, flipped.size());
+        flipped.swap(halved);
+    }
+    if (reduction > 0) {
+        std::cerr << "Sprite atlas uploaded at " << size << " texels a side to fit the texture budget\n";
+    }
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, layers_, 0,
+        GL_RGBA, GL_UNSIGNED_BYTE, flipped.data());
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    bytes_ = flipped.size() * 4 / 3;
+    memoryAllocated(MEMORY_GPU_TEXTURES, bytes_);
+    memoryFreed(MEMORY_DECODE_SCRATCH, flipped.size());
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mapped_file.h"
+
+const int ATLAS_LAYER_SIZE = 256;   // texels per side of every layer
+const int ATLAS_MAX_LAYERS = 64;
+const int ATLAS_MAX_REDUCTION = 2;  // halvings a texture budget may force on the uploaded layers
+const char* const ATLAS_CACHE_FILE = "aquarium_atlas.bin";
+const int ATLAS_OUTLINE_VERTICES = 8;  // most corners of a traced sprite outline
+const int ATLAS_OUTLINE_ALPHA = 8;      // texels at or above this alpha are inside
+
+// Cache file layout (host byte order, not portable; a file from the other
+// byte order fails the magic check and is rebuilt):
+//   AtlasCacheHeader     32 bytes
+//   RGBA8 texels         layerCount * ATLAS_LAYER_SIZE^2 * 4 bytes, layer after layer
+//   SpriteOutline        one per sheet
+const uint32_t ATLAS_CACHE_MAGIC = 0x54415141; // "AQAT"
+const uint16_t ATLAS_CACHE_VERSION = 3;
+
+struct AtlasCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t layerSize;
+    uint32_t layerCount;
+    uint64_t sourceHash;        // over every source image and its sheet layout, in order
+    uint64_t payloadChecksum;
+};
+
+// A source image with `columns` animation frames side by side. A one-column
+// sheet with swimFrames set is bent along a travelling wave into that many
+// frames of a swim cycle instead.
+struct SpriteSheet {
+    const char* path;
+    int columns;
+    int swimFrames;
+};
+
+// Where a sheet's frames ended up: consecutive layers from firstLayer.
+struct SpriteAnimation {
+    int firstLayer;
+    int frames;
+};
+
+// Convex polygon around every texel of a sheet that is visible in any of
+// its frames, in texture coordinates, counter-clockwise. Drawing this
+// instead of the full quad skips shading the transparent corners.
+struct SpriteOutline {
+    int32_t vertexCount;
+    float uv[ATLAS_OUTLINE_VERTICES][2];
+};
+
+// Every sprite frame, one per GL_TEXTURE_2D_ARRAY layer, so fish of any mix
+// of species and animation frames draw with one texture bound and a
+// per-instance layer index. Sources are resampled to ATLAS_LAYER_SIZE with an
+// alpha-weighted box filter; the result is cached on disk and reused while
+// the source files are unchanged, so the full-size images are only decoded
+// after an edit. With an asset pack open, the atlas is taken from the pack
+// instead and the source files are not read at all. Cached and packed texels
+// are used in place from the mapping rather than copied.
+class SpriteAtlas {
+public:
+    bool load(const SpriteSheet* sheets, int count, const char* cachePath);
+    // Like load(), but keeps the texels on the CPU only, for the software
+    // renderer; texture() stays 0.
+    bool loadTexels(const SpriteSheet* sheets, int count, const char* cachePath);
+    // Serializes the loaded atlas in the cache file layout, for the asset pack.
+    void encode(std::vector<uint8_t>& out) const;
+    // Creates the texture from texels loaded earlier, possibly on another
+    // thread; needs the GL context current. Layers are halved as often as it
+    // takes to fit the texture budget with `reservedTextureBytes` of it kept
+    // for textures still to come.
+    void upload(size_t reservedTextureBytes = 0);
+    void destroy();
+
+    GLuint texture() const { return texture_; }
+    int layers() const { return layers_; }
+    const SpriteAnimation& animation(int sheet) const { return animations_[sheet]; }
+    const SpriteOutline& outline(int sheet) const { return outlines_[sheet]; }
+    // Texels of the layers as uploaded, layer after layer, for CPU-side use.
+    const uint8_t* texels() const { return texels_; }
+
+private:
+    bool readPack();
+    bool readCache(const char* cachePath, uint64_t sourceHash);
+    // Takes texels and outlines from the cache file layout. A packed atlas
+    // has no sources to match and its checksum is the pack's to check.
+    bool decode(const uint8_t* data, size_t size, uint64_t sourceHash, bool packed);
+    bool build(const SpriteSheet* sheets, int count);
+    void writeCache(const char* cachePath);
+
+    GLuint texture_ = 0;
+    int layers_ = 0;
+    size_t bytes_ = 0;
+    uint64_t sourceHash_ = 0;
+    const uint8_t* texels_ = nullptr;   // into builtTexels_, cacheFile_ or the asset pack
+    std::vector<uint8_t> builtTexels_;
+    MappedFile cacheFile_;
+    std::vector<SpriteAnimation> animations_;
+    std::vector<SpriteOutline> outlines_;
+};
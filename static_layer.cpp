@@ -0,0 +1,176 @@
+#include "static_layer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "aquarium.h"
+#include "frame_arena.h"
+#include "memory_budget.h"
+#include "perf_hud.h"
+#include "profiler.h"
+#include "render_queue.h"
+
+// A quad, two triangles of 2D positions, for every tile.
+static const size_t STATIC_LAYER_VERTEX_BYTES = STATIC_LAYER_TILES * STATIC_LAYER_TILES * 6 * 2 * sizeof(float);
+
+static const char* compositeVertexShaderSrc = R"glsl(
+#version 330 core
+layout(location=0) in vec2 aPos;
+out vec2 TexCoord;
+
+void main() {
+    gl_Position = vec4(aPos, 0.0, 1.0);
+    TexCoord = aPos * 0.5 + 0.5;
+}
+)glsl";
+
+static const char* compositeFragmentShaderSrc = R"glsl(
+#version 330 core
+in vec2 TexCoord;
+out vec4 FragColor;
+
+uniform sampler2D layer;
+
+void main() {
+    FragColor = texture(layer, TexCoord);
+}
+)glsl";
+
+bool StaticLayer::init() {
+    program_ = createShaderProgram(compositeVertexShaderSrc, compositeFragmentShaderSrc);
+    glUseProgram(program_);
+    glUniform1i(glGetUniformLocation(program_, "layer"), 0);
+    glUseProgram(0);
+
+    // Room for a quad per tile; endRedraw() fills in the covered ones.
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, STATIC_LAYER_VERTEX_BYTES, nullptr, GL_DYNAMIC_DRAW);
+    memoryAllocated(MEMORY_GPU_BUFFERS, STATIC_LAYER_VERTEX_BYTES);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    glGenFramebuffers(1, &fbo_);
+    glGenTextures(1, &texture_);
+    return true;
+}
+
+void StaticLayer::shutdown() {
+    glDeleteProgram(program_);
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &vbo_);
+    glDeleteFramebuffers(1, &fbo_);
+    glDeleteTextures(1, &texture_);
+    if (vbo_) memoryFreed(MEMORY_GPU_BUFFERS, STATIC_LAYER_VERTEX_BYTES);
+    memoryFreed(MEMORY_GPU_TEXTURES, textureBytes_);
+    program_ = vao_ = vbo_ = fbo_ = texture_ = 0;
+    width_ = height_ = 0;
+    textureBytes_ = 0;
+    valid_ = false;
+    compositeVertices_ = 0;
+}
+
+bool StaticLayer::resize(int width, int height) {
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Static layer framebuffer incomplete (0x" << std::hex << status << std::dec << ")\n";
+        return false;
+    }
+
+    memoryFreed(MEMORY_GPU_TEXTURES, textureBytes_);
+    textureBytes_ = (size_t)width * height * 4;
+    memoryAllocated(MEMORY_GPU_TEXTURES, textureBytes_);
+    width_ = width;
+    height_ = height;
+    return true;
+}
+
+bool StaticLayer::needsRedraw(uint64_t key, int width, int height) {
+    if (valid_ && key == key_ && width == width_ && height == height_) return false;
+    pendingKey_ = key;
+    pendingWidth_ = width;
+    pendingHeight_ = height;
+    std::memset(covered_, 0, sizeof(covered_));
+    return true;
+}
+
+void StaticLayer::cover(float x0, float y0, float x1, float y1) {
+    auto tile = [](float ndc) {
+        return std::min(std::max((int)((ndc + 1.0f) * 0.5f * STATIC_LAYER_TILES), 0), STATIC_LAYER_TILES - 1);
+    };
+    if (x1 <= -1.0f || x0 >= 1.0f || y1 <= -1.0f || y0 >= 1.0f) return;
+    int tx1 = tile(x1), ty1 = tile(y1);
+    for (int ty = tile(y0); ty <= ty1; ty++) {
+        for (int tx = tile(x0); tx <= tx1; tx++) covered_[ty][tx] = true;
+    }
+}
+
+void StaticLayer::beginRedraw() {
+    PROFILE_SCOPE("Static layer redraw");
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer_);
+    glGetIntegerv(GL_VIEWPORT, viewport_);
+    valid_ = false;
+    if ((pendingWidth_ != width_ || pendingHeight_ != height_) && !resize(pendingWidth_, pendingHeight_)) {
+        width_ = height_ = 0;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glViewport(0, 0, width_, height_);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void StaticLayer::endRedraw() {
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glViewport(viewport_[0], viewport_[1], viewport_[2], viewport_[3]);
+    if (width_ == 0) return;
+
+    // One quad per run of covered tiles along each row.
+    FrameVector<float> vertices;
+    const float step = 2.0f / STATIC_LAYER_TILES;
+    for (int ty = 0; ty < STATIC_LAYER_TILES; ty++) {
+        for (int tx = 0; tx < STATIC_LAYER_TILES;) {
+            if (!covered_[ty][tx]) {
+                tx++;
+                continue;
+            }
+            int start = tx;
+            while (tx < STATIC_LAYER_TILES && covered_[ty][tx]) tx++;
+            float x0 = -1.0f + start * step, x1 = -1.0f + tx * step;
+            float y0 = -1.0f + ty * step, y1 = y0 + step;
+            vertices.insert(vertices.end(), { x0, y0, x1, y0, x1, y1, x0, y0, x1, y1, x0, y1 });
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
+    compositeVertices_ = (GLsizei)(vertices.size() / 2);
+    key_ = pendingKey_;
+    valid_ = true;
+}
+
+void StaticLayer::composite(GLStateCache& state) {
+    if (!valid_ || compositeVertices_ == 0) return;
+    state.useProgram(program_);
+    state.bindVertexArray(vao_);
+    state.bindTexture(GL_TEXTURE_2D, texture_);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, compositeVertices_);
+    countDrawCall();
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
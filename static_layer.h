@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+class GLStateCache;
+
+const int STATIC_LAYER_TILES = 16;  // coverage grid cells per axis
+
+// An offscreen copy of content that changes rarely, such as the HUD or fish
+// lying dead on the bottom. The owner sums up the content in a key each
+// frame; only when the key or the viewport size changes is the content
+// drawn again, into the layer's texture. Every frame the texture is blended
+// over the framebuffer, but only across the grid tiles the content covered
+// when it was drawn, so a sparse layer costs little fill.
+//
+// Content is drawn with separate alpha blending, which leaves premultiplied
+// color in the texture; the composite blends it with GL_ONE, so the result
+// matches drawing the content directly.
+class StaticLayer {
+public:
+    bool init();
+    void shutdown();
+
+    // True if the texture does not hold `key` at this viewport size. The
+    // content must then be drawn between beginRedraw() and endRedraw()
+    // this frame, and cover() called for everything in it.
+    bool needsRedraw(uint64_t key, int width, int height);
+    // Marks an NDC rectangle as holding content.
+    void cover(float x0, float y0, float x1, float y1);
+
+    // Redirects drawing into the layer's texture, cleared to transparent.
+    void beginRedraw();
+    // Restores the framebuffer, viewport and blending of the frame.
+    void endRedraw();
+
+    // Blends the cached content over the current framebuffer.
+    void composite(GLStateCache& state);
+
+    size_t textureBytes() const { return textureBytes_; }
+
+private:
+    bool resize(int width, int height);
+
+    GLuint program_ = 0;
+    GLuint vao_ = 0, vbo_ = 0;
+    GLuint fbo_ = 0, texture_ = 0;
+    int width_ = 0, height_ = 0;
+    size_t textureBytes_ = 0;
+
+    uint64_t key_ = 0;
+    bool valid_ = false;
+    uint64_t pendingKey_ = 0;
+    int pendingWidth_ = 0, pendingHeight_ = 0;
+    bool covered_[STATIC_LAYER_TILES][STATIC_LAYER_TILES] = {};
+    GLsizei compositeVertices_ = 0;
+
+    GLint framebuffer_ = 0;
+    GLint viewport_[4] = {};
+};
@@ -0,0 +1,150 @@
+#include "stream_buffer.h"
+
+#include <iostream>
+
+#include "gl_extensions.h"
+#include "memory_budget.h"
+#include "profiler.h"
+
+StreamBuffer streamBuffer;
+
+bool StreamBuffer::init(size_t size) {
+    shutdown();
+    regionSize_ = size / STREAM_BUFFER_FRAMES;
+    size_ = regionSize_ * STREAM_BUFFER_FRAMES;
+    region_ = 0;
+    head_ = 0;
+    stalls_ = 0;
+
+    glGenBuffers(1, &buffer_);
+    generation_++;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    if (glExt.bufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glExt.BufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr)size_, nullptr, flags);
+        mapped_ = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)size_, flags);
+        if (!mapped_) {
+            // Immutable storage cannot fall back to orphaning; start over.
+            std::cerr << "Persistent mapping failed, streaming with unsynchronized maps\n";
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &buffer_);
+            glGenBuffers(1, &buffer_);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+        }
+    }
+    if (!mapped_) {
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)size_, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    memoryAllocated(MEMORY_GPU_BUFFERS, size_);
+    return true;
+}
+
+void StreamBuffer::shutdown() {
+    if (!buffer_) return;
+    for (GLsync& fence : fences_) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (mapped_ || mappedRange_) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &buffer_);
+    memoryFreed(MEMORY_GPU_BUFFERS, size_);
+    buffer_ = 0;
+    mapped_ = nullptr;
+    mappedRange_ = false;
+}
+
+void StreamBuffer::waitForRegion(int region) {
+    GLsync& fence = fences_[region];
+    if (!fence) return;
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        PROFILE_SCOPE("Stream buffer wait");
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void* StreamBuffer::allocate(size_t size, size_t alignment, GLintptr& offset) {
+    size_t regionStart = (size_t)region_ * regionSize_;
+    size_t at = regionStart + head_;
+    at = (at + alignment - 1) / alignment * alignment;
+    if (size > regionSize_) {
+        std::cerr << "Stream allocation of " << size << " bytes exceeds the " << regionSize_ << " byte region\n";
+        return nullptr;
+    }
+    if (at + size > regionStart + regionSize_) {
+        // The frame outgrew its region. Queued draw packets only read their
+        // data when the queue executes, so restarting the region while any
+        // are pending would overwrite vertices not drawn yet. reserve() is
+        // the guard: the renderer sizes the region for the whole queued frame
+        // up front, so only immediate draws made after the queue has run (the
+        // perf HUD) can get here, and by then everything written so far has
+        // been submitted and the region can be reused once the GPU catches up.
+        PROFILE_SCOPE("Stream buffer overflow");
+        stalls_++;
+        if (mapped_) {
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            glDeleteSync(fence);
+        }
+        else {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)size_, nullptr, GL_STREAM_DRAW);
+        }
+        at = (regionStart + alignment - 1) / alignment * alignment;
+    }
+    head_ = at + size - regionStart;
+    offset = (GLintptr)at;
+
+    if (mapped_) return mapped_ + at;
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    void* memory = glMapBufferRange(GL_ARRAY_BUFFER, offset, (GLsizeiptr)size,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    mappedRange_ = memory != nullptr;
+    return memory;
+}
+
+bool StreamBuffer::reserve(size_t frameBytes) {
+    if (frameBytes <= regionSize_) return false;
+    PROFILE_SCOPE("Stream buffer grow");
+    size_t regionSize = regionSize_ ? regionSize_ : STREAM_BUFFER_SIZE / STREAM_BUFFER_FRAMES;
+    while (regionSize < frameBytes) regionSize *= 2;
+    glFinish();
+    uint64_t stalls = stalls_;
+    init(regionSize * STREAM_BUFFER_FRAMES);
+    stalls_ = stalls;
+    return true;
+}
+
+void StreamBuffer::commit() {
+    // Persistent mappings are coherent; only the fallback has a range to unmap.
+    if (!mappedRange_) return;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    mappedRange_ = false;
+}
+
+void StreamBuffer::endFrame() {
+    if (!buffer_) return;
+    if (mapped_) {
+        fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    region_ = (region_ + 1) % STREAM_BUFFER_FRAMES;
+    head_ = 0;
+    if (mapped_) {
+        waitForRegion(region_);
+    }
+    else if (region_ == 0) {
+        // Orphan: the driver hands back fresh storage and frees the old
+        // copy once the GPU is done with it.
+        glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)size_, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
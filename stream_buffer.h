@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+const size_t STREAM_BUFFER_SIZE = 4 * 1024 * 1024;
+const int STREAM_BUFFER_FRAMES = 3;     // frames the GPU may still be reading
+
+// One vertex buffer that all per-frame dynamic data is written into: text,
+// UI batches, instance data. It is split into STREAM_BUFFER_FRAMES regions
+// used round-robin, one per frame, and allocations are bump-allocated from
+// the current region, so an upload is a memcpy into mapped memory.
+//
+// With buffer storage the whole buffer stays persistently mapped and a fence
+// per region keeps the CPU from overwriting data a frame still in flight
+// reads; by the time a region comes round again its fence has long passed.
+// Without it, each allocation is mapped with GL_MAP_UNSYNCHRONIZED_BIT and
+// the buffer is orphaned whenever the ring wraps, which gives the same
+// guarantee without fences.
+class StreamBuffer {
+public:
+    bool init(size_t size = STREAM_BUFFER_SIZE);
+    void shutdown();
+
+    // Returns `size` writable bytes starting at an offset that is a multiple
+    // of `alignment` (a vertex stride, so draws can start at offset / stride).
+    // The memory must be written before commit() and not read back.
+    void* allocate(size_t size, size_t alignment, GLintptr& offset);
+    // Makes the last allocation visible to the GPU; call before drawing from it.
+    void commit();
+
+    // Grows the buffer so a frame can allocate `frameBytes` without wrapping.
+    // Waits for the GPU and replaces the buffer object when it has to grow,
+    // so call it before the frame's first allocation and re-point any VAO
+    // at buffer() if it returns true; code that does not call it checks
+    // generation() instead.
+    bool reserve(size_t frameBytes);
+
+    // Call once per frame after the last draw that uses this buffer.
+    void endFrame();
+
+    GLuint buffer() const { return buffer_; }
+    // Changes whenever the buffer object is replaced. GL may hand the new
+    // buffer the old one's name, so VAOs compare this instead of buffer().
+    uint64_t generation() const { return generation_; }
+    bool persistent() const { return mapped_ != nullptr; }
+    // Times an allocation did not fit its region and had to wait for the GPU.
+    uint64_t stalls() const { return stalls_; }
+
+private:
+    void waitForRegion(int region);
+
+    GLuint buffer_ = 0;
+    size_t size_ = 0;
+    size_t regionSize_ = 0;
+    uint8_t* mapped_ = nullptr;         // persistent mapping, or null
+    bool mappedRange_ = false;          // fallback path: a range is mapped now
+    GLsync fences_[STREAM_BUFFER_FRAMES] = {};
+    int region_ = 0;
+    size_t head_ = 0;                   // next free byte within the region
+    uint64_t stalls_ = 0;
+    uint64_t generation_ = 0;
+};
+
+// Shared by everything that streams vertices; owned by the Renderer.
+extern StreamBuffer streamBuffer;
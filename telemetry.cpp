@@ -0,0 +1,327 @@
+#include "telemetry.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "gorilla.h"
+#include "profiler.h"
+
+static const uint32_t TELEMETRY_MAGIC = 0x4D545141;       // "AQTM"
+static const uint32_t TELEMETRY_BLOCK_MAGIC = 0x42545141; // "AQTB"
+static const uint16_t TELEMETRY_VERSION = 1;
+
+enum TelemetryColumnType : uint8_t {
+    COLUMN_INT = 0,
+    COLUMN_FLOAT = 1,
+};
+
+struct TelemetryColumn {
+    const char* name;
+    TelemetryColumnType type;
+    size_t offset;
+};
+
+static const TelemetryColumn telemetryColumns[] = {
+    { "time_us", COLUMN_INT, offsetof(TelemetrySample, timeMicros) },
+    { "tick", COLUMN_INT, offsetof(TelemetrySample, tick) },
+    { "fish_count", COLUMN_INT, offsetof(TelemetrySample, fishCount) },
+    { "dying_count", COLUMN_INT, offsetof(TelemetrySample, dyingCount) },
+    { "oxygen", COLUMN_FLOAT, offsetof(TelemetrySample, oxygen) },
+    { "food", COLUMN_FLOAT, offsetof(TelemetrySample, food) },
+    { "happiness_mean", COLUMN_FLOAT, offsetof(TelemetrySample, happinessMean) },
+    { "happiness_min", COLUMN_FLOAT, offsetof(TelemetrySample, happinessMin) },
+    { "happiness_p10", COLUMN_FLOAT, offsetof(TelemetrySample, happinessP10) },
+    { "happiness_p50", COLUMN_FLOAT, offsetof(TelemetrySample, happinessP50) },
+    { "happiness_p90", COLUMN_FLOAT, offsetof(TelemetrySample, happinessP90) },
+};
+static const size_t TELEMETRY_COLUMN_COUNT = sizeof(telemetryColumns) / sizeof(telemetryColumns[0]);
+
+// FishStats
+
+float FishStats::percentile(float p) const {
+    uint32_t target = (uint32_t)(p * count_);
+    uint32_t seen = 0;
+    for (int i = 0; i < HAPPINESS_BINS; i++) {
+        seen += bins_[i];
+        if (seen > target) return (i + 0.5f) / HAPPINESS_BINS;
+    }
+    return 1.0f;
+}
+
+void FishStats::finish(TelemetrySample& sample) const {
+    sample.fishCount = count_;
+    sample.dyingCount = dying_;
+    if (count_ == 0) {
+        sample.happinessMean = sample.happinessMin = 0.0f;
+        sample.happinessP10 = sample.happinessP50 = sample.happinessP90 = 0.0f;
+        return;
+    }
+    sample.happinessMean = (float)(sum_ / count_);
+    sample.happinessMin = min_;
+    sample.happinessP10 = percentile(0.1f);
+    sample.happinessP50 = percentile(0.5f);
+    sample.happinessP90 = percentile(0.9f);
+}
+
+// TelemetryRecorder
+
+TelemetryRecorder::~TelemetryRecorder() {
+    stop();
+}
+
+static void writeU8(std::ofstream& file, uint8_t v) { file.write(reinterpret_cast<const char*>(&v), 1); }
+static void writeU16(std::ofstream& file, uint16_t v) { file.write(reinterpret_cast<const char*>(&v), 2); }
+static void writeU32(std::ofstream& file, uint32_t v) { file.write(reinterpret_cast<const char*>(&v), 4); }
+
+static bool hasMatchingHeader(const char* path, bool& exists) {
+    std::ifstream file(path, std::ios::binary);
+    exists = file && file.peek() != std::ifstream::traits_type::eof();
+    if (!exists) return false;
+    uint32_t magic = 0;
+    uint16_t version = 0, columns = 0;
+    file.read(reinterpret_cast<char*>(&magic), 4);
+    file.read(reinterpret_cast<char*>(&version), 2);
+    file.read(reinterpret_cast<char*>(&columns), 2);
+    return file && magic == TELEMETRY_MAGIC && version == TELEMETRY_VERSION && columns == TELEMETRY_COLUMN_COUNT;
+}
+
+// Moves past the column directory; the schema is fixed per version.
+static void skipColumnDirectory(std::ifstream& file) {
+    file.seekg(8);
+    for (size_t c = 0; c < TELEMETRY_COLUMN_COUNT; c++) {
+        char typeAndLen[2];
+        file.read(typeAndLen, 2);
+        file.seekg((uint8_t)typeAndLen[1], std::ios::cur);
+    }
+}
+
+// Reads a block header. Fails at the end of the file, on a header cut short
+// and on a row count no writer produces, which would otherwise be trusted
+// to size the decode.
+static bool readBlockHeader(std::ifstream& file, uint32_t& rows, uint32_t sizes[TELEMETRY_COLUMN_COUNT]) {
+    uint32_t magic = 0;
+    return file.read(reinterpret_cast<char*>(&magic), 4) && magic == TELEMETRY_BLOCK_MAGIC &&
+        file.read(reinterpret_cast<char*>(&rows), 4) && rows > 0 && rows <= TELEMETRY_BLOCK_SAMPLES &&
+        file.read(reinterpret_cast<char*>(sizes), TELEMETRY_COLUMN_COUNT * sizeof(uint32_t));
+}
+
+// Offset just past the last complete block: a crash while a block was
+// being appended leaves a torn one after it.
+static uint64_t completeBlocksEnd(const char* path, uint64_t& fileSize) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    fileSize = (uint64_t)file.tellg();
+    skipColumnDirectory(file);
+    uint64_t end = (uint64_t)file.tellg();
+    uint32_t rows, sizes[TELEMETRY_COLUMN_COUNT];
+    while (readBlockHeader(file, rows, sizes)) {
+        uint64_t blockEnd = (uint64_t)file.tellg();
+        for (uint32_t size : sizes) blockEnd += size;
+        if (blockEnd > fileSize) break;
+        end = blockEnd;
+        file.seekg((std::streamoff)blockEnd);
+    }
+    return end;
+}
+
+static bool truncateFile(const char* path, uint64_t size) {
+#ifdef _WIN32
+    int fd = -1;
+    if (_sopen_s(&fd, path, _O_RDWR | _O_BINARY, _SH_DENYNO, 0) != 0) return false;
+    bool ok = _chsize_s(fd, (__int64)size) == 0;
+    _close(fd);
+    return ok;
+#else
+    return truncate(path, (off_t)size) == 0;
+#endif
+}
+
+bool TelemetryRecorder::start(const char* path) {
+    stop();
+    path_ = path;
+
+    // Append to an existing recording of the same schema, otherwise start a
+    // new file. Appending after a torn block would hide every later block
+    // from readers, so the file is cut back to its last complete block first.
+    bool exists = false;
+    bool matches = hasMatchingHeader(path, exists);
+    if (matches) {
+        uint64_t fileSize = 0;
+        uint64_t end = completeBlocksEnd(path, fileSize);
+        if (end < fileSize) {
+            std::cerr << "Telemetry file " << path << " ends in a torn block, dropping its last "
+                << fileSize - end << " bytes\n";
+            if (!truncateFile(path, end)) {
+                std::cerr << "Failed to truncate " << path << ", starting over\n";
+                matches = false;
+            }
+        }
+    }
+    if (!matches) {
+        if (exists && !matches) std::cerr << "Telemetry file " << path << " has a different format, starting over\n";
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Failed to open " << path << " for writing\n";
+            return false;
+        }
+        writeU32(file, TELEMETRY_MAGIC);
+        writeU16(file, TELEMETRY_VERSION);
+        writeU16(file, (uint16_t)TELEMETRY_COLUMN_COUNT);
+        for (const TelemetryColumn& column : telemetryColumns) {
+            uint8_t len = (uint8_t)std::strlen(column.name);
+            writeU8(file, column.type);
+            writeU8(file, len);
+            file.write(column.name, len);
+        }
+    }
+
+    ring_.reset(new TelemetrySample[TELEMETRY_RING_CAPACITY]);
+    head_ = 0;
+    tail_ = 0;
+    lastSample_ = -1.0f;
+    running_ = true;
+    worker_ = std::thread(&TelemetryRecorder::run, this);
+    return true;
+}
+
+void TelemetryRecorder::stop() {
+    if (!worker_.joinable()) return;
+    running_ = false;
+    worker_.join();
+}
+
+bool TelemetryRecorder::due(float now) {
+    if (!running_.load(std::memory_order_relaxed)) return false;
+    if (lastSample_ >= 0.0f && now - lastSample_ < TELEMETRY_SAMPLE_INTERVAL) return false;
+    lastSample_ = now;
+    return true;
+}
+
+bool TelemetryRecorder::push(const TelemetrySample& sample) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= TELEMETRY_RING_CAPACITY) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ring_[head & (TELEMETRY_RING_CAPACITY - 1)] = sample;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void TelemetryRecorder::drain(std::vector<TelemetrySample>& block, bool flushPartial) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    while (tail != head) {
+        block.push_back(ring_[tail & (TELEMETRY_RING_CAPACITY - 1)]);
+        tail++;
+        tail_.store(tail, std::memory_order_release);
+        if (block.size() == TELEMETRY_BLOCK_SAMPLES) {
+            writeBlock(block);
+            block.clear();
+        }
+    }
+    if (flushPartial && !block.empty()) {
+        writeBlock(block);
+        block.clear();
+    }
+}
+
+void TelemetryRecorder::run() {
+    PROFILE_THREAD_NAME("Telemetry writer");
+    std::vector<TelemetrySample> block;
+    block.reserve(TELEMETRY_BLOCK_SAMPLES);
+    // Polling keeps push() free of any notification; the ring holds several
+    // seconds of samples at 1 kHz, far longer than the poll period.
+    while (running_.load(std::memory_order_relaxed)) {
+        drain(block, false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    drain(block, true);
+}
+
+bool TelemetryRecorder::writeBlock(const std::vector<TelemetrySample>& block) {
+    PROFILE_SCOPE("Telemetry block");
+    std::vector<uint8_t> payloads[TELEMETRY_COLUMN_COUNT];
+    std::vector<int64_t> ints(block.size());
+    std::vector<float> floats(block.size());
+    BitWriter bits;
+
+    for (size_t c = 0; c < TELEMETRY_COLUMN_COUNT; c++) {
+        const TelemetryColumn& column = telemetryColumns[c];
+        bits.clear();
+        for (size_t i = 0; i < block.size(); i++) {
+            const char* field = reinterpret_cast<const char*>(&block[i]) + column.offset;
+            if (column.type == COLUMN_INT) std::memcpy(&ints[i], field, sizeof(int64_t));
+            else std::memcpy(&floats[i], field, sizeof(float));
+        }
+        if (column.type == COLUMN_INT) encodeIntColumn(ints.data(), block.size(), bits);
+        else encodeFloatColumn(floats.data(), block.size(), bits);
+        payloads[c] = bits.finish();
+    }
+
+    std::ofstream file(path_, std::ios::binary | std::ios::app);
+    if (!file) {
+        std::cerr << "Failed to append to " << path_ << "\n";
+        return false;
+    }
+    writeU32(file, TELEMETRY_BLOCK_MAGIC);
+    writeU32(file, (uint32_t)block.size());
+    for (const std::vector<uint8_t>& payload : payloads) writeU32(file, (uint32_t)payload.size());
+    for (const std::vector<uint8_t>& payload : payloads) {
+        file.write(reinterpret_cast<const char*>(payload.data()), (std::streamsize)payload.size());
+    }
+    return (bool)file;
+}
+
+bool readTelemetryFile(const char* path, std::vector<TelemetrySample>& out) {
+    std::ifstream file(path, std::ios::binary);
+    bool exists = false;
+    if (!hasMatchingHeader(path, exists)) return false;
+
+    skipColumnDirectory(file);
+
+    // A torn block ends the data; the rows before it are still returned.
+    std::vector<uint8_t> payload;
+    std::vector<int64_t> ints;
+    std::vector<float> floats;
+    for (;;) {
+        if (file.peek() == std::ifstream::traits_type::eof()) break;
+        uint32_t rows = 0, sizes[TELEMETRY_COLUMN_COUNT];
+        bool ok = readBlockHeader(file, rows, sizes);
+        size_t base = out.size();
+        if (ok) {
+            out.resize(base + rows);
+            ints.resize(rows);
+            floats.resize(rows);
+        }
+        for (size_t c = 0; ok && c < TELEMETRY_COLUMN_COUNT; c++) {
+            const TelemetryColumn& column = telemetryColumns[c];
+            payload.resize(sizes[c]);
+            ok = (bool)file.read(reinterpret_cast<char*>(payload.data()), sizes[c]);
+            BitReader reader(payload.data(), payload.size());
+            ok = ok && (column.type == COLUMN_INT
+                ? decodeIntColumn(reader, rows, ints.data())
+                : decodeFloatColumn(reader, rows, floats.data()));
+            for (size_t i = 0; ok && i < rows; i++) {
+                char* field = reinterpret_cast<char*>(&out[base + i]) + column.offset;
+                if (column.type == COLUMN_INT) std::memcpy(field, &ints[i], sizeof(int64_t));
+                else std::memcpy(field, &floats[i], sizeof(float));
+            }
+        }
+        if (!ok) {
+            out.resize(base);
+            std::cerr << "Telemetry file " << path << " has a torn block after " << out.size() << " rows\n";
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aquarium.h"
+
+const char* const TELEMETRY_FILE = "aquarium_telemetry.aqtm";
+const float TELEMETRY_SAMPLE_INTERVAL = 0.001f;   // seconds, i.e. up to 1 kHz
+const size_t TELEMETRY_RING_CAPACITY = 8192;      // samples, power of two
+const size_t TELEMETRY_BLOCK_SAMPLES = 1024;      // samples per file block
+
+struct TelemetrySample {
+    int64_t timeMicros;
+    int64_t tick;
+    int64_t fishCount;
+    int64_t dyingCount;
+    float oxygen;
+    float food;
+    float happinessMean;
+    float happinessMin;
+    float happinessP10;
+    float happinessP50;
+    float happinessP90;
+};
+
+// Per-fish aggregates gathered inside the simulation loop, so sampling adds
+// no extra pass over the fish. Percentiles come from a fixed histogram and
+// are accurate to 1/HAPPINESS_BINS.
+class FishStats {
+public:
+    static const int HAPPINESS_BINS = 64;
+
+    void reset() {
+        count_ = 0;
+        dying_ = 0;
+        sum_ = 0.0;
+        min_ = 1.0f;
+        for (uint32_t& b : bins_) b = 0;
+    }
+
+    void add(const Fish& f) {
+        count_++;
+        dying_ += f.isDying ? 1 : 0;
+        sum_ += f.happiness;
+        if (f.happiness < min_) min_ = f.happiness;
+        int bin = (int)(f.happiness * HAPPINESS_BINS);
+        bins_[bin < 0 ? 0 : (bin >= HAPPINESS_BINS ? HAPPINESS_BINS - 1 : bin)]++;
+    }
+
+    // Fills the fish columns of 'sample'.
+    void finish(TelemetrySample& sample) const;
+
+private:
+    float percentile(float p) const;
+
+    uint32_t count_ = 0;
+    uint32_t dying_ = 0;
+    double sum_ = 0.0;
+    float min_ = 1.0f;
+    uint32_t bins_[HAPPINESS_BINS] = {};
+};
+
+// Records samples into a single-producer/single-consumer ring that a
+// background thread drains into an append-only columnar file. Each block
+// holds TELEMETRY_BLOCK_SAMPLES rows stored column by column, with
+// Gorilla delta-of-delta and XOR compression per column. push() is
+// wait-free; when the ring is full the sample is dropped and counted.
+//
+// File layout:
+//   "AQTM" magic, u16 version, u16 column count, per column: u8 type, u8 name length, name
+//   blocks: "AQTB" magic, u32 rows, u32 byte size per column, column payloads
+class TelemetryRecorder {
+public:
+    ~TelemetryRecorder();
+
+    bool start(const char* path);
+    // Writes out everything still queued and stops the writer thread.
+    void stop();
+
+    // True when at least TELEMETRY_SAMPLE_INTERVAL has passed since the last sample.
+    bool due(float now);
+    bool push(const TelemetrySample& sample);
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void drain(std::vector<TelemetrySample>& block, bool flushPartial);
+    bool writeBlock(const std::vector<TelemetrySample>& block);
+
+    std::string path_;
+    std::unique_ptr<TelemetrySample[]> ring_;
+    alignas(64) std::atomic<size_t> head_{ 0 }; // next slot the producer writes
+    alignas(64) std::atomic<size_t> tail_{ 0 }; // next slot the consumer reads
+    alignas(64) std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<bool> running_{ false };
+    std::thread worker_;
+    float lastSample_ = -1.0f;
+};
+
+// Decodes a whole telemetry file, for tools and tests. Rows up to a torn
+// block are returned; false only if the file is missing or of another format.
+bool readTelemetryFile(const char* path, std::vector<TelemetrySample>& out);
@@ -0,0 +1,227 @@
+#include "video_export.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "aquarium.h"
+#include "frame_arena.h"
+#include "frame_encoder.h"
+#include "gpu_timer.h"
+#include "input_journal.h"
+#include "memory_budget.h"
+#include "offscreen_context.h"
+#include "profiler.h"
+#include "renderer.h"
+#include "shader_cache.h"
+#include "snapshot.h"
+#include "software_renderer.h"
+#include "telemetry.h"
+
+// Ring of pixel pack buffers. glReadPixels into a bound PBO returns at once;
+// a buffer is only mapped EXPORT_PBO_COUNT - 1 frames later, by which time
+// the copy has normally finished and mapping does not stall the pipeline.
+struct ReadbackRing {
+    GLuint buffers[EXPORT_PBO_COUNT] = {};
+    GLsync fences[EXPORT_PBO_COUNT] = {};
+    size_t frameBytes = 0;
+
+    void init(int width, int height) {
+        frameBytes = (size_t)width * height * 4;
+        glGenBuffers(EXPORT_PBO_COUNT, buffers);
+        for (GLuint buffer : buffers) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        memoryAllocated(MEMORY_GPU_BUFFERS, EXPORT_PBO_COUNT * frameBytes);
+    }
+
+    void shutdown() {
+        for (GLsync& fence : fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        glDeleteBuffers(EXPORT_PBO_COUNT, buffers);
+        memoryFreed(MEMORY_GPU_BUFFERS, EXPORT_PBO_COUNT * frameBytes);
+        frameBytes = 0;
+    }
+
+    void read(int slot, int width, int height) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // Copies a finished readback into `out`.
+    bool collect(int slot, uint8_t* out) {
+        PROFILE_SCOPE("Readback collect");
+        if (fences[slot]) {
+            GLenum wait = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            glDeleteSync(fences[slot]);
+            fences[slot] = nullptr;
+            if (wait == GL_WAIT_FAILED) {
+                std::cerr << "Waiting for a readback failed\n";
+                return false;
+            }
+            // After a timeout the map below waits for the copy instead.
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+        void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT);
+        if (pixels) {
+            std::memcpy(out, pixels, frameBytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return pixels != nullptr;
+    }
+};
+
+static bool endsWith(const std::string& s, const char* suffix) {
+    size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+int runVideoExport(const AppOptions& options) {
+    PROFILE_THREAD_NAME("Main");
+    const std::string& path = options.exportPath;
+    FrameFormat format;
+    if (endsWith(path, ".y4m")) format = FRAME_FORMAT_Y4M;
+    else if (endsWith(path, ".png")) format = FRAME_FORMAT_PNG;
+    else {
+        std::cerr << "Export path must end in .y4m or .png: " << path << "\n";
+        return -1;
+    }
+    int width = options.exportWidth;
+    int height = options.exportHeight;
+    int fps = options.exportFps;
+
+    // Same starting tank as the windowed app, or the journal's for a replay.
+    SnapshotLevels levels;
+    InputJournalReader journal;
+    bool fromJournal = !options.replayPath.empty();
+    bool restoredTank = fromJournal
+        ? journal.open(options.replayPath.c_str(), fishes, levels)
+        : loadSnapshot(SNAPSHOT_FILE, fishes, levels);
+    if (fromJournal && !restoredTank) return -1;
+    if (restoredTank) {
+        oxygenLevel = levels.oxygen;
+        foodLevel = levels.food;
+        areFishesDying = levels.fishesDying;
+        applyFishBudget();
+    }
+    else {
+        loadStatus(oxygenLevel, foodLevel);
+        initFishes(8);
+    }
+    simulationTick = 0;
+    srand(fromJournal ? journal.seed() : EXPORT_SEED);
+
+    // The simulation always advances in journal-sized ticks, so a replay
+    // matches its recording at any export frame rate.
+    float fixedDt = fromJournal ? journal.fixedDt() : JOURNAL_FIXED_DT;
+    float seconds = options.exportSeconds;
+    if (seconds <= 0.0f) seconds = fromJournal ? journal.endTick() * fixedDt : EXPORT_DEFAULT_SECONDS;
+    int frames = (int)std::ceil(seconds * fps);
+
+    // Without a usable GL context the frames are drawn on the CPU instead;
+    // they come out in the same bottom-up layout as a readback.
+    bool software = options.software;
+    OffscreenContext context;
+    if (!software && !context.create()) {
+        std::cerr << "Exporting with the software renderer instead\n";
+        software = true;
+    }
+    RenderTarget target;
+    Renderer renderer;
+    SoftwareRenderer softwareRenderer;
+    ReadbackRing ring;
+    if (software) {
+        if (!softwareRenderer.init(width, height)) return -1;
+    }
+    else {
+        if (!target.create(width, height)) return -1;
+        // Sets the viewport, which the renderer plans its texture budget by.
+        target.bind();
+        shaderCache.load(SHADER_CACHE_FILE);
+        if (!renderer.init()) return -1;
+        shaderCache.flush();
+        renderer.finishLoading();
+        ring.init(width, height);
+    }
+    GpuTimer gpuTimer; // left uninitialized: no GPU zones while exporting
+
+    FrameEncoder encoder;
+    if (!encoder.start(path.c_str(), format, width, height, fps)) return -1;
+
+    std::cout << "Exporting " << frames << " frames at " << width << "x" << height << ", " << fps << " fps to " << path
+        << (software ? " with the software renderer" : "") << "\n";
+    FishStats fishStats;
+    FrameHeapCheck heapCheck;
+    if (!software) {
+        target.bind();
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    }
+    // Software frames are ready as soon as they are drawn.
+    int latency = software ? 0 : EXPORT_PBO_COUNT - 1;
+    auto exportStart = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (int frame = 0; frame < frames + latency && ok; frame++) {
+        PROFILE_SCOPE("Export frame");
+        if (frame < frames) {
+            heapCheck.begin();
+            float frameTime = (float)frame / fps;
+            uint64_t targetTick = (uint64_t)(frameTime / fixedDt + 0.5f);
+            while (simulationTick < targetTick) {
+                if (fromJournal) journal.applyEvents(simulationTick);
+                stepSimulation(fixedDt, fishStats);
+            }
+
+            RenderScene scene;
+            scene.fishes = &fishes;
+            scene.oxygen = oxygenLevel;
+            scene.food = foodLevel;
+            scene.time = frameTime;
+            if (software) {
+                softwareRenderer.render(scene);
+            }
+            else {
+                renderer.render(scene, gpuTimer);
+                ring.read(frame % EXPORT_PBO_COUNT, width, height);
+                renderer.endFrame();
+                glFlush();
+            }
+            heapCheck.end();
+        }
+
+        int oldest = frame - latency;
+        if (oldest >= 0 && oldest < frames) {
+            uint8_t* pixels = encoder.acquire();
+            if (software) std::memcpy(pixels, softwareRenderer.pixels(), (size_t)width * height * 4);
+            else ok = ring.collect(oldest % EXPORT_PBO_COUNT, pixels);
+            // A failed readback leaves the buffer unfilled; the export stops
+            // here, and the encoder drops its buffers when stopped.
+            if (ok) encoder.submit(pixels);
+        }
+    }
+    float renderSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - exportStart).count();
+    if (!ok) std::cerr << "Failed to map a readback buffer\n";
+    if (!encoder.stop()) ok = false;
+    float totalSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - exportStart).count();
+
+    std::cout << "Wrote " << encoder.framesWritten() << " frames (" << frames / (float)fps << " s of video) in "
+        << totalSeconds << " s, " << frames / (float)fps / totalSeconds << "x real time; "
+        << "rendering took " << renderSeconds << " s, " << encoder.stallSeconds() << " s of it waiting on the encoder\n";
+    printMemoryReport(std::cout);
+
+    if (!software) {
+        ring.shutdown();
+        renderer.shutdown();
+        target.destroy();
+    }
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "options.h"
+
+const int EXPORT_PBO_COUNT = 3;             // readbacks in flight before one is mapped
+const float EXPORT_DEFAULT_SECONDS = 10.0f; // without a journal to set the length
+const unsigned EXPORT_SEED = 1;
+
+// Renders the tank offscreen at options.exportWidth x exportHeight and
+// exportFps and writes it to options.exportPath: a .y4m file, or a numbered
+// .png sequence. The tank comes from --replay when given, otherwise from the
+// saved snapshot. Frames are read back through a ring of pixel buffer objects
+// and encoded on a background thread, so nothing waits on the display and
+// export runs as fast as rendering allows. Returns the process exit code.
+int runVideoExport(const AppOptions& options);
@@ -0,0 +1,325 @@
+#include "water_overlay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "aquarium.h"
+#include "asset_pack.h"
+#include "atomic_file.h"
+#include "frame_arena.h"
+#include "memory_budget.h"
+#include "profiler.h"
+#include "render_queue.h"
+#include "snapshot.h"
+#include "stb_image.h"
+
+static_assert(sizeof(OverlayCacheHeader) == 32, "OverlayCacheHeader must stay 32 bytes");
+
+// Light levels at or below the median become black; this fraction of the
+// texels, the brightest, becomes full light.
+static const double OVERLAY_FULL_LIGHT_FRACTION = 0.001;
+// Halvings a texture budget may force on the uploaded image.
+static const int OVERLAY_MAX_REDUCTION = 3;
+
+static const char* overlayVertexShaderSrc = R"glsl(
+#version 330 core
+layout(location=0) in vec2 aPos;
+out vec2 vPos;
+
+void main() {
+    gl_Position = vec4(aPos, 0.0, 1.0);
+    vPos = aPos;
+}
+)glsl";
+
+static const char* overlayFragmentShaderSrc = R"glsl(
+#version 330 core
+in vec2 vPos;
+out vec4 FragColor;
+
+uniform sampler2D overlay;
+uniform float u_time;
+uniform vec2 u_scale;
+
+void main() {
+    // Rows are stored top-down.
+    vec2 uv = vec2(vPos.x * 0.5 + 0.5, 0.5 - vPos.y * 0.5) * u_scale;
+    // A slow drift, bent by two low sine waves so the lines sway like the
+    // surface that casts them.
+    uv += vec2(0.012, 0.005) * u_time;
+    uv += vec2(sin(uv.y * 11.0 + u_time * 0.8), sin(uv.x * 9.0 - u_time * 0.6)) * 0.008;
+    float light = texture(overlay, uv).r;
+    FragColor = vec4(vec3(0.75, 0.9, 1.0) * (light * 0.22), 1.0);
+}
+)glsl";
+
+bool WaterOverlayImage::load(const char* sourcePath, const char* cachePath, bool allowBuild) {
+    PROFILE_SCOPE("Water overlay load");
+    release();
+    if (readPack()) return true;
+
+    // Hashing the encoded file is far cheaper than decoding it.
+    MappedFile source;
+    if (!source.open(sourcePath)) {
+        std::cerr << "Failed to load " << sourcePath << "\n";
+        return false;
+    }
+    sourceHash_ = (snapshotChecksum(source.data(), source.size()) ^ (uint64_t)WATER_OVERLAY_WIDTH) * 0x100000001b3ull;
+    source.close();
+
+    if (readCache(cachePath, sourceHash_)) return true;
+    if (!allowBuild) {
+        std::cerr << "The water overlay is not built yet; run with --pack to build it\n";
+        return false;
+    }
+    if (!build(sourcePath)) return false;
+    writeCache(cachePath);
+    return true;
+}
+
+void WaterOverlayImage::release() {
+    width_ = height_ = 0;
+    sourceHash_ = 0;
+    pixels_ = nullptr;
+    builtPixels_.clear();
+    builtPixels_.shrink_to_fit();
+    cacheFile_.close();
+}
+
+bool WaterOverlayImage::readPack() {
+    if (!assetPack.isOpen()) return false;
+    AssetView packed = assetPack.find(ASSET_WATER_OVERLAY);
+    return packed.data && decode(packed.data, packed.size, 0, true);
+}
+
+bool WaterOverlayImage::readCache(const char* cachePath, uint64_t sourceHash) {
+    if (!cacheFile_.open(cachePath)) return false;
+    if (!decode(cacheFile_.data(), cacheFile_.size(), sourceHash, false)) {
+        cacheFile_.close();
+        return false;
+    }
+    return true;
+}
+
+bool WaterOverlayImage::decode(const uint8_t* data, size_t size, uint64_t sourceHash, bool packed) {
+    OverlayCacheHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    size_t payloadSize = (size_t)header.width * header.height;
+    if (header.magic != OVERLAY_CACHE_MAGIC || header.version != OVERLAY_CACHE_VERSION ||
+        header.headerSize != sizeof(header) || payloadSize == 0 ||
+        (!packed && header.sourceHash != sourceHash) || size != sizeof(header) + payloadSize) {
+        return false;
+    }
+    const uint8_t* payload = data + sizeof(header);
+    if (!packed && snapshotChecksum(payload, payloadSize) != header.payloadChecksum) {
+        std::cerr << "Water overlay cache is corrupt, rebuilding\n";
+        return false;
+    }
+    width_ = header.width;
+    height_ = header.height;
+    sourceHash_ = header.sourceHash;
+    pixels_ = payload;
+    return true;
+}
+
+bool WaterOverlayImage::build(const char* sourcePath) {
+    PROFILE_SCOPE("Water overlay build");
+    // Ask for luminance, which stb converts to while unpacking, so the
+    // full-size image is one byte per texel.
+    int sourceWidth, sourceHeight, channels;
+    unsigned char* data = stbi_load(sourcePath, &sourceWidth, &sourceHeight, &channels, 1);
+    if (!data) {
+        std::cerr << "Failed to load " << sourcePath << "\n";
+        return false;
+    }
+    width_ = std::min(WATER_OVERLAY_WIDTH, sourceWidth);
+    height_ = std::max(1, (int)std::lround((double)sourceHeight * width_ / sourceWidth));
+    if (height_ > 0xffff) {
+        std::cerr << sourcePath << " is too tall for a water overlay\n";
+        stbi_image_free(data);
+        return false;
+    }
+
+    builtPixels_.resize((size_t)width_ * height_);
+    uint32_t histogram[256] = {};
+    for (int y = 0; y < height_; y++) {
+        int y0 = y * sourceHeight / height_;
+        int y1 = std::max(y0 + 1, (y + 1) * sourceHeight / height_);
+        for (int x = 0; x < width_; x++) {
+            int x0 = x * sourceWidth / width_;
+            int x1 = std::max(x0 + 1, (x + 1) * sourceWidth / width_);
+            uint64_t sum = 0;
+            for (int sy = y0; sy < y1; sy++) {
+                const unsigned char* row = data + (size_t)sy * sourceWidth;
+                for (int sx = x0; sx < x1; sx++) sum += row[sx];
+            }
+            uint64_t texels = (uint64_t)(x1 - x0) * (y1 - y0);
+            uint8_t value = (uint8_t)((sum + texels / 2) / texels);
+            builtPixels_[(size_t)y * width_ + x] = value;
+            histogram[value]++;
+        }
+    }
+    stbi_image_free(data);
+
+    // Stretch the levels so only the bright lines remain.
+    size_t total = builtPixels_.size();
+    size_t seen = 0;
+    int low = -1, high = 255;
+    for (int value = 0; value < 256; value++) {
+        seen += histogram[value];
+        if (low < 0 && seen * 2 >= total) low = value;
+        if (seen >= total - (size_t)(total * OVERLAY_FULL_LIGHT_FRACTION)) {
+            high = value;
+            break;
+        }
+    }
+    if (high <= low) high = low + 1;
+    for (uint8_t& texel : builtPixels_) {
+        int value = (texel - low) * 255 / (high - low);
+        texel = (uint8_t)std::min(255, std::max(0, value));
+    }
+    pixels_ = builtPixels_.data();
+    return true;
+}
+
+void WaterOverlayImage::encode(std::vector<uint8_t>& out) const {
+    OverlayCacheHeader header = {};
+    header.magic = OVERLAY_CACHE_MAGIC;
+    header.version = OVERLAY_CACHE_VERSION;
+    header.headerSize = sizeof(header);
+    header.width = (uint16_t)width_;
+    header.height = (uint16_t)height_;
+    header.sourceHash = sourceHash_;
+    size_t payloadSize = (size_t)width_ * height_;
+    header.payloadChecksum = snapshotChecksum(pixels_, payloadSize);
+    out.resize(sizeof(header));
+    std::memcpy(out.data(), &header, sizeof(header));
+    out.insert(out.end(), pixels_, pixels_ + payloadSize);
+}
+
+void WaterOverlayImage::writeCache(const char* cachePath) {
+    std::vector<uint8_t> bytes;
+    encode(bytes);
+
+    // A missing cache only costs a rebuild next time, so failures are not fatal.
+    AtomicFileWriter writer;
+    if (!writer.open(cachePath) || !writer.write(bytes.data(), bytes.size()) || !writer.commit()) {
+        std::cerr << "Failed to write water overlay cache " << cachePath << "\n";
+    }
+}
+
+bool WaterOverlayPass::init() {
+    shader_ = createShaderProgram(overlayVertexShaderSrc, overlayFragmentShaderSrc);
+
+    float quad[] = {
+        -1.0f, -1.0f,
+         1.0f, -1.0f,
+         1.0f,  1.0f,
+        -1.0f,  1.0f,
+    };
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    glUseProgram(shader_);
+    glUniform1i(glGetUniformLocation(shader_, "overlay"), 0);
+    timeLoc_ = glGetUniformLocation(shader_, "u_time");
+    scaleLoc_ = glGetUniformLocation(shader_, "u_scale");
+    glUseProgram(0);
+
+    loadState_.store(OVERLAY_LOADING);
+    loader_ = std::thread([this] {
+        PROFILE_THREAD_NAME("Water overlay loader");
+        bool loaded = image_.load(WATER_OVERLAY_FILE, WATER_OVERLAY_CACHE_FILE, false);
+        loadState_.store(loaded ? OVERLAY_LOADED : OVERLAY_FAILED, std::memory_order_release);
+    });
+    return true;
+}
+
+void WaterOverlayPass::shutdown() {
+    if (loader_.joinable()) loader_.join();
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &vbo_);
+    glDeleteProgram(shader_);
+    glDeleteTextures(1, &texture_);
+    memoryFreed(MEMORY_GPU_TEXTURES, textureBytes_);
+    vao_ = vbo_ = shader_ = texture_ = 0;
+    textureBytes_ = 0;
+    image_.release();
+}
+
+void WaterOverlayPass::finishLoading() {
+    if (loader_.joinable()) loader_.join();
+}
+
+// Averages every 2x2 block; an odd last row or column is dropped.
+static void halveImage(const uint8_t* src, int width, int height, uint8_t* dst) {
+    int halfWidth = std::max(1, width / 2), halfHeight = std::max(1, height / 2);
+    for (int y = 0; y < halfHeight; y++) {
+        const uint8_t* row0 = src + (size_t)std::min(2 * y, height - 1) * width;
+        const uint8_t* row1 = src + (size_t)std::min(2 * y + 1, height - 1) * width;
+        for (int x = 0; x < halfWidth; x++) {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            dst[(size_t)y * halfWidth + x] = (uint8_t)((row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) / 4);
+        }
+    }
+}
+
+void WaterOverlayPass::upload(size_t reservedTextureBytes) {
+    finishLoading();
+    int width = image_.width(), height = image_.height();
+    const uint8_t* pixels = image_.pixels();
+    // Uploading happens mid-frame and the smaller copy is gone once GL has
+    // it, so it comes from the frame arena.
+    FrameVector<uint8_t> reduced;
+    int reduction = textureReduction((size_t)width * height, OVERLAY_MAX_REDUCTION, reservedTextureBytes);
+    for (int i = 0; i < reduction; i++) {
+        FrameVector<uint8_t> halved((size_t)std::max(1, width / 2) * std::max(1, height / 2));
+        halveImage(pixels, width, height, halved.data());
+        reduced.swap(halved);
+        pixels = reduced.data();
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    if (reduction > 0) {
+        std::cerr << "Water overlay uploaded at " << width << "x" << height << " to fit the texture budget\n";
+    }
+
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // Mirroring hides the seams of an image that was not drawn to tile.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Keep texels square on the window whatever the image's aspect.
+    glUseProgram(shader_);
+    glUniform2f(scaleLoc_, 1.0f, (float)WINDOW_HEIGHT / WINDOW_WIDTH * width / height);
+    glUseProgram(0);
+
+    textureBytes_ = (size_t)width * height;
+    memoryAllocated(MEMORY_GPU_TEXTURES, textureBytes_);
+    image_.release();
+}
+
+void WaterOverlayPass::submit(RenderQueue& queue, float time, size_t reservedTextureBytes) {
+    if (!texture_) {
+        if (loadState_.load(std::memory_order_acquire) != OVERLAY_LOADED) return;
+        upload(reservedTextureBytes);
+    }
+    DrawPacket& packet = queue.submit(LAYER_WATER_OVERLAY, shader_, texture_, vao_, GL_TRIANGLE_FAN, 0, 4);
+    packet.set1f(timeLoc_, time);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+
+class RenderQueue;
+
+const char* const WATER_OVERLAY_FILE = "water_overlay.png";
+const char* const WATER_OVERLAY_CACHE_FILE = "aquarium_overlay.bin";
+const int WATER_OVERLAY_WIDTH = 800;        // texels across; the height keeps the source's aspect
+
+// Cache file layout (host byte order, like the atlas cache):
+//   OverlayCacheHeader   32 bytes
+//   R8 light intensity   width * height bytes, top row first
+const uint32_t OVERLAY_CACHE_MAGIC = 0x564f5141; // "AQOV"
+const uint16_t OVERLAY_CACHE_VERSION = 1;
+
+struct OverlayCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint16_t width;
+    uint16_t height;
+    uint32_t reserved;
+    uint64_t sourceHash;        // over the encoded source file
+    uint64_t payloadChecksum;
+};
+
+// The caustics image reduced to what the overlay pass draws: one byte of
+// light per texel at display resolution. The source is a photo-sized JPEG,
+// so it is box-filtered down to WATER_OVERLAY_WIDTH, turned to luminance and
+// stretched so the median is dark and the brightest lines are full, leaving
+// only the light pattern. The result comes from the asset pack, or from a
+// cache that matches the source. Decoding the source takes most of a second
+// and around 400 MB while it runs, so only the pack build (--pack) does it;
+// without a pack or a current cache, the pass draws no overlay.
+class WaterOverlayImage {
+public:
+    // 'allowBuild' decodes the source when neither the pack nor the cache has
+    // the image, and writes the cache.
+    bool load(const char* sourcePath, const char* cachePath, bool allowBuild);
+    // Serializes the image in the cache file layout, for the asset pack.
+    void encode(std::vector<uint8_t>& out) const;
+    void release();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    const uint8_t* pixels() const { return pixels_; }
+
+private:
+    bool readPack();
+    bool readCache(const char* cachePath, uint64_t sourceHash);
+    bool decode(const uint8_t* data, size_t size, uint64_t sourceHash, bool packed);
+    bool build(const char* sourcePath);
+    void writeCache(const char* cachePath);
+
+    int width_ = 0, height_ = 0;
+    uint64_t sourceHash_ = 0;
+    const uint8_t* pixels_ = nullptr;   // into builtPixels_, cacheFile_ or the asset pack
+    std::vector<uint8_t> builtPixels_;
+    MappedFile cacheFile_;
+};
+
+// Caustic light over the finished scene: one full-screen draw that samples
+// the overlay with a slow drift and a sine wobble and adds it to the
+// framebuffer, so no copy of the scene is needed. The image loads on a
+// thread of its own and the pass draws nothing until it has arrived, so
+// neither startup nor the first frames wait for it. On the GPU it is a
+// single-channel R8 texture, and the CPU copy is dropped once uploaded.
+class WaterOverlayPass {
+public:
+    ~WaterOverlayPass() { finishLoading(); }
+
+    // Creates the program and starts loading the image.
+    bool init();
+    void shutdown();
+    // Waits for the image, for renders that must look the same from their
+    // first frame on.
+    void finishLoading();
+
+    // Uploads the image once it has arrived and queues the pass.
+    // `reservedTextureBytes` is kept free of the texture budget for
+    // textures that are not made yet.
+    void submit(RenderQueue& queue, float time, size_t reservedTextureBytes = 0);
+
+private:
+    enum LoadState { OVERLAY_LOADING, OVERLAY_LOADED, OVERLAY_FAILED };
+
+    void upload(size_t reservedTextureBytes);
+
+    GLuint shader_ = 0;
+    GLuint vao_ = 0, vbo_ = 0;
+    GLuint texture_ = 0;
+    size_t textureBytes_ = 0;
+    GLint timeLoc_ = -1, scaleLoc_ = -1;
+
+    WaterOverlayImage image_;
+    std::thread loader_;
+    std::atomic<int> loadState_{ OVERLAY_LOADING };
+};